@@ -6,6 +6,7 @@
 #define LINKED_LIST_H
 
 #include "../mpointer/mpointer.h"
+#include <cstddef>
 #include <iostream>
 #include <stdexcept>
 
@@ -69,42 +70,79 @@ private:
 
 template <typename T>
 void LinkedList<T>::pushBack(const T& value) {
-    MPointer<Node> newNode = MPointer<Node>::New();
+    if (!MPointerConnection::client_) {
+        throw std::runtime_error("MPointer no inicializado. Llame a MPointerConnection::Init primero.");
+    }
+
+    // Crear el nodo, escribirlo y enlazarlo desde la cola en una sola ida y
+    // vuelta, en vez de un CREATE, un SET, un GET y otro SET por separado
     Node nodeData(value);
-    *newNode = nodeData;
+    std::vector<char> data(sizeof(Node));
+    std::memcpy(data.data(), &nodeData, sizeof(Node));
+
+    SocketClient::Batch batch;
+    int node = batch.create(sizeof(Node), MPointer<Node>::typeId(), typeid(Node).name());
+    batch.set(node, data);
+    // El nodo nace con una referencia; la segunda es para head_ si la lista
+    // está vacía o, si no, para el enlace desde la cola anterior
+    batch.increaseRefCount(node);
+    if (!isEmpty()) {
+        batch.link(&tail_, offsetof(Node, next_id), node);
+        batch.decreaseRefCount(&tail_, tail_.weight());     // tail_ deja de apuntar a la cola anterior
+    }
 
-    if (isEmpty()) {
-        head_ = newNode;
-        tail_ = newNode;
-    } else {
-        Node tailNode = *tail_;
-        tailNode.next_id = &newNode;
-        *tail_ = tailNode;
-        tail_ = newNode;
+    std::vector<Message> responses = MPointerConnection::client_->execute(batch);
+    for (const Message& response : responses) {
+        if (!response.isSuccess()) {
+            throw std::runtime_error("Error al añadir el nodo al final de la lista");
+        }
     }
+    int id = SocketClient::createdBlockId(responses[0]);
 
+    // Las referencias ya se contaron en el BATCH
+    if (isEmpty()) {
+        head_.adopt(id);
+    }
+    tail_.adopt(id);
     size_++;
-    // Liberar newNode para que su destructor no haga decref
-    newNode.release();
 }
 
 template <typename T>
 void LinkedList<T>::pushFront(const T& value) {
-    MPointer<Node> newNode = MPointer<Node>::New();
+    if (!MPointerConnection::client_) {
+        throw std::runtime_error("MPointer no inicializado. Llame a MPointerConnection::Init primero.");
+    }
+
+    // Como pushBack: el nodo se crea ya enlazado con la cabeza anterior
     Node nodeData(value);
-    if (head_.isValid()) {
-        nodeData.next_id = &head_;
+    nodeData.next_id = &head_;
+    std::vector<char> data(sizeof(Node));
+    std::memcpy(data.data(), &nodeData, sizeof(Node));
+
+    SocketClient::Batch batch;
+    int node = batch.create(sizeof(Node), MPointer<Node>::typeId(), typeid(Node).name());
+    batch.set(node, data);
+    if (isEmpty()) {
+        batch.increaseRefCount(node);   // La segunda referencia es la de tail_
+    } else if (head_.weight() > 1) {
+        // La referencia de head_ a la cabeza anterior pasa a ser el enlace
+        // desde el nodo nuevo, que como todos los enlaces tiene peso 1
+        batch.decreaseRefCount(&head_, head_.weight() - 1);
+    }
+
+    std::vector<Message> responses = MPointerConnection::client_->execute(batch);
+    for (const Message& response : responses) {
+        if (!response.isSuccess()) {
+            throw std::runtime_error("Error al añadir el nodo al principio de la lista");
+        }
     }
-    *newNode = nodeData;
-    
-    head_ = newNode;
+    int id = SocketClient::createdBlockId(responses[0]);
+
     if (isEmpty()) {
-        tail_ = newNode;
+        tail_.adopt(id);
     }
-    
+    head_.adopt(id);
     size_++;
-    // Liberar newNode para que su destructor no haga decref
-    newNode.release();
 }
 
 template <typename T>
@@ -113,17 +151,14 @@ T LinkedList<T>::get(size_t index) const {
         throw std::out_of_range("Índice fuera de rango");
     }
 
-    MPointer<Node> current = head_;
-    for (size_t i = 0; i < index; i++) {
-        Node currentNode = *current;
-        if (currentNode.next_id < 0) {
-             throw std::runtime_error("Error de lógica: Se alcanzó el final de la lista inesperadamente en get");
-        }
-        current = MPointer<Node>(currentNode.next_id);
+    // El servidor sigue los next_id: una ida y vuelta en vez de un GET y un
+    // MPointer temporal por cada nodo recorrido
+    SocketClient::ChasedBlock block = MPointerConnection::client_->chase(&head_, offsetof(Node, next_id), index);
+    if (block.data.size() < sizeof(Node)) {
+        throw std::runtime_error("Error de lógica: Se alcanzó el final de la lista inesperadamente en get");
     }
-
-    Node resultNode = *current;
-    current.release();
+    Node resultNode;
+    std::memcpy(&resultNode, block.data.data(), sizeof(Node));
     return resultNode.data;
 }
 
@@ -141,36 +176,47 @@ void LinkedList<T>::remove(size_t index) {
     }
 
     if (index == 0) {
-        Node headNode = *head_;
-        if(headNode.next_id >= 0) {
-            head_ = MPointer<Node>(headNode.next_id);
+        // Sólo hace falta el enlace, no el dato del nodo. La referencia de
+        // head_ se devuelve al salir removed de ámbito, y head_ se queda con
+        // la del enlace que salía del nodo eliminado
+        int next_id = head_.field(&Node::next_id);
+        MPointer<Node> removed = std::move(head_);
+        if(next_id >= 0) {
+            head_.adopt(next_id);
         } else {
-            head_ = MPointer<Node>();
             tail_ = MPointer<Node>();
         }
     } else {
-        MPointer<Node> prev = head_;
-        for (size_t i = 0; i < index - 1; i++) {
-            Node prevNode = *prev;
-            if (prevNode.next_id < 0) {
-                 throw std::runtime_error("Error de lógica: Se alcanzó el final de la lista inesperadamente en remove");
-            }
-            prev = MPointer<Node>(prevNode.next_id);
-        }
-
-        Node prevNode = *prev;
-        int remove_id = prevNode.next_id;
-        if(remove_id < 0) {
+        // El nodo anterior y el que se elimina, con dos CHASE en un solo BATCH
+        SocketClient::Batch walk;
+        int prev = walk.chase(&head_, offsetof(Node, next_id), static_cast<uint32_t>(index - 1));
+        walk.chase(prev, offsetof(Node, next_id), 1);
+        std::vector<Message> found = MPointerConnection::client_->execute(walk);
+        if (!found[1].isSuccess()) {
              throw std::runtime_error("Error de lógica: El nodo a eliminar no existe");
         }
-        MPointer<Node> toRemove = MPointer<Node>(remove_id);
-        Node toRemoveNode = *toRemove;
-
-        prevNode.next_id = toRemoveNode.next_id;
-        *prev = prevNode;
-
+        int prev_id = SocketClient::chasedBlock(found[0]).id;
+        SocketClient::ChasedBlock toRemove = SocketClient::chasedBlock(found[1]);
+        Node toRemoveNode;
+        std::memcpy(&toRemoveNode, toRemove.data.data(), sizeof(Node));
+
+        // Saltar el nodo escribiendo sólo el next_id del anterior; si era la
+        // cola, tail_ pasa al anterior en el mismo BATCH
+        // El enlace que salía del nodo pasa al anterior; el que llegaba se devuelve
+        SocketClient::Batch unlink;
+        unlink.link(prev_id, offsetof(Node, next_id), toRemoveNode.next_id);
+        unlink.decreaseRefCount(toRemove.id);
         if (toRemoveNode.next_id < 0) {
-            tail_ = prev;
+            unlink.increaseRefCount(prev_id);
+            unlink.decreaseRefCount(&tail_, tail_.weight());
+        }
+        for (const Message& response : MPointerConnection::client_->execute(unlink)) {
+            if (!response.isSuccess()) {
+                throw std::runtime_error("Error al eliminar el nodo de la lista");
+            }
+        }
+        if (toRemoveNode.next_id < 0) {
+            tail_.adopt(prev_id);
         }
     }
 
@@ -184,18 +230,14 @@ void LinkedList<T>::print() const {
         return;
     }
 
-    MPointer<Node> current = head_;
+    // Los nodos siguen vivos por los enlaces: basta con referencias prestadas,
+    // sin tocar los contadores en cada paso
+    MPointerRef<Node> current = head_;
     std::cout << "Lista: ";
     while (current.isValid()) {
         Node currentNode = *current;
         std::cout << currentNode.data << " ";
-        int next_id = currentNode.next_id;
-        if (next_id >= 0) {
-            current = MPointer<Node>(next_id);
-        } else {
-            current.release();
-            break;
-        }
+        current = MPointerRef<Node>(currentNode.next_id);
     }
     std::cout << std::endl;
 }
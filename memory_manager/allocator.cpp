@@ -0,0 +1,41 @@
+// allocator.cpp
+#include "allocator.h"
+#include "free_list_allocator.h"
+#include "tlsf_allocator.h"
+#include "buddy_allocator.h"
+#include "slab_allocator.h"
+
+std::unique_ptr<Allocator> makeAllocator(AllocationPolicy policy, size_t pool_size,
+                                         size_t slab_threshold) {
+    std::unique_ptr<Allocator> allocator;
+    switch (policy) {
+        case AllocationPolicy::TLSF:
+            allocator = std::make_unique<TlsfAllocator>(pool_size);
+            break;
+        case AllocationPolicy::BUDDY:
+            allocator = std::make_unique<BuddyAllocator>(pool_size);
+            break;
+        case AllocationPolicy::FREE_LIST:
+        default:
+            allocator = std::make_unique<FreeListAllocator>(pool_size);
+            break;
+    }
+
+    if (slab_threshold > 0) {
+        allocator = std::make_unique<SlabAllocator>(std::move(allocator), slab_threshold);
+    }
+    return allocator;
+}
+
+bool parseAllocationPolicy(const std::string& text, AllocationPolicy& policy) {
+    if (text == "freelist") {
+        policy = AllocationPolicy::FREE_LIST;
+    } else if (text == "tlsf") {
+        policy = AllocationPolicy::TLSF;
+    } else if (text == "buddy") {
+        policy = AllocationPolicy::BUDDY;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Placement policies that MemoryManager can use inside memory_pool_
+enum class AllocationPolicy {
+    FREE_LIST,  // Best-fit over an offset/size ordered free extent index
+    TLSF,       // Two-Level Segregated Fit, O(1) allocate and release
+    BUDDY       // Binary buddy system, power-of-two blocks, no compaction
+};
+
+// Manages which ranges of the pool are free. Allocators only hand out offsets:
+// they never touch the pool memory itself, so the single malloc (MM-02) stays
+// in MemoryManager.
+//
+// 'handle' is allocator-private bookkeeping returned by allocate(); it has to be
+// passed back unchanged to release() and slideDown().
+class Allocator {
+public:
+    virtual ~Allocator() = default;
+
+    virtual bool allocate(size_t size, size_t& offset, uint32_t& handle) = 0;
+    virtual void release(size_t offset, size_t size, uint32_t handle) = 0;
+
+    // Moves an allocation down into the free space directly below it (used by
+    // compaction). On success 'offset' holds the new position; the caller moves the data.
+    virtual bool slideDown(size_t& offset, size_t size, uint32_t handle) = 0;
+    virtual bool supportsCompaction() const { return true; }
+    // Allocations that compaction must leave where they are
+    virtual bool pinned(uint32_t handle) const { return false; }
+
+    virtual size_t freeBytes() const = 0;
+    virtual size_t freeExtentCount() const = 0;
+    virtual size_t largestFreeExtent() const = 0;
+    virtual const char* name() const = 0;
+};
+
+// Blocks up to this many bytes are served from slabs by default (0 disables slabs)
+constexpr size_t kDefaultSlabThreshold = 256;
+constexpr size_t kMaxSlabThreshold = 4096;
+
+std::unique_ptr<Allocator> makeAllocator(AllocationPolicy policy, size_t pool_size,
+                                         size_t slab_threshold = 0);
+bool parseAllocationPolicy(const std::string& text, AllocationPolicy& policy);
+
+#endif //ALLOCATOR_H
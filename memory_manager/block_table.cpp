@@ -0,0 +1,107 @@
+// block_table.cpp
+#include "block_table.h"
+#include <algorithm>
+#include <climits>
+
+BlockTable::BlockTable(uint32_t index_base, uint32_t max_slots)
+    : index_base_(index_base), max_slots_(max_slots), slot_count_(0), count_(0), reclaim_head_(kNone) {
+}
+
+BlockTable::~BlockTable() = default;
+
+int BlockTable::insert(size_t offset, size_t size, uint32_t type_id, uint32_t alloc_handle, uint32_t refs) {
+    uint32_t slot;
+    uint32_t generation;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.front();
+        free_slots_.pop_front();
+        generation = generationOf(at(slot).state[slot & (kChunkSize - 1)].load(std::memory_order_relaxed));
+    } else {
+        uint32_t slot_count = slot_count_.load(std::memory_order_relaxed);
+        if (slot_count == max_slots_) {
+            return -1;
+        }
+        slot = slot_count;
+        if (!chunks_[slot >> kChunkBits]) {
+            chunks_[slot >> kChunkBits] = std::make_unique<Chunk>();
+        }
+        generation = 1;
+        // Publishes the chunk to lock-free lookups
+        slot_count_.store(slot_count + 1, std::memory_order_release);
+    }
+
+    Chunk& chunk = at(slot);
+    uint32_t i = slot & (kChunkSize - 1);
+    chunk.offset[i] = offset;
+    chunk.size[i] = size;
+    chunk.alloc_handle[i] = alloc_handle;
+    chunk.flags[i] = kOccupied | kInUse;
+    chunk.type_id[i] = type_id;
+    chunk.state[i].store(pack(generation, std::clamp<uint32_t>(refs, 1, INT32_MAX)), std::memory_order_release);
+    count_++;
+    return idOf(slot);
+}
+
+void BlockTable::remove(uint32_t slot) {
+    Chunk& chunk = at(slot);
+    uint32_t i = slot & (kChunkSize - 1);
+    if (!(chunk.flags[i] & kOccupied)) {
+        return;
+    }
+
+    chunk.flags[i] = 0;
+
+    // Invalidate outstanding ids; generation 0 is never used so ids stay positive and non-zero
+    uint32_t generation = generationOf(chunk.state[i].load(std::memory_order_relaxed)) + 1;
+    if (generation > kMaxGeneration) {
+        generation = 1;
+    }
+    chunk.state[i].store(pack(generation, 0), std::memory_order_release);
+
+    free_slots_.push_back(slot);
+    count_--;
+}
+
+bool BlockTable::addRef(int id, int& count, uint32_t amount) {
+    uint32_t slot, generation;
+    if (!locate(id, slot, generation)) {
+        return false;
+    }
+
+    std::atomic<uint64_t>& state = at(slot).state[slot & (kChunkSize - 1)];
+    uint64_t current = state.load(std::memory_order_relaxed);
+    do {
+        if (generationOf(current) != generation || countOf(current) == 0 ||
+            countOf(current) > uint32_t(INT32_MAX) - amount) {
+            return false;
+        }
+    } while (!state.compare_exchange_weak(current, current + amount, std::memory_order_relaxed));
+    count = static_cast<int>(countOf(current) + amount);
+    return true;
+}
+
+bool BlockTable::dropRef(int id, int& count, uint32_t amount) {
+    uint32_t slot, generation;
+    if (!locate(id, slot, generation)) {
+        return false;
+    }
+
+    std::atomic<uint64_t>& state = at(slot).state[slot & (kChunkSize - 1)];
+    uint64_t current = state.load(std::memory_order_relaxed);
+    do {
+        if (generationOf(current) != generation || countOf(current) == 0 || countOf(current) < amount) {
+            return false;
+        }
+    } while (!state.compare_exchange_weak(current, current - amount, std::memory_order_acq_rel));
+
+    count = static_cast<int>(countOf(current) - amount);
+    if (count == 0) {
+        // Last reference: only this call gets here for this generation
+        uint32_t& next = at(slot).reclaim_next[slot & (kChunkSize - 1)];
+        next = reclaim_head_.load(std::memory_order_relaxed);
+        while (!reclaim_head_.compare_exchange_weak(next, slot, std::memory_order_release,
+                                                    std::memory_order_relaxed)) {
+        }
+    }
+    return true;
+}
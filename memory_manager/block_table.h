@@ -0,0 +1,166 @@
+#ifndef BLOCK_TABLE_H
+#define BLOCK_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+// Metadata of every block, stored column by column in an index-addressed slot array.
+//
+// A block id packs the slot index with the generation of that slot:
+//
+//     id = generation << kIndexBits | slot
+//
+// Looking a block up is a bounds check plus a generation compare. When a block
+// is removed its slot's generation is bumped, so stale ids stop matching and
+// the slot can be recycled safely. Ids are always positive ints, so the 31
+// bits are split between the two: kIndexBits caps the live blocks of a whole
+// MemoryManager (all shards together) at kMaxSlots, about a million, and
+// leaves kGenerationBits for the generation. A slot's generation wraps around
+// after kMaxGeneration reuses, so an id only aliases a newer block if it is
+// kept that long; removed slots are reused oldest first so that each one
+// advances as slowly as possible. No slot is ever taken out of use, however
+// many blocks a long-running server creates.
+//
+// Columns live in fixed-size chunks that are allocated on demand and never
+// move, so growing the table never copies or invalidates existing metadata.
+//
+// A table may own just a sub-range of the index space (one per MemoryManager
+// shard): its slots are numbered from 0, and ids carry index_base + slot.
+//
+// Everything is guarded by the owner's mutex except reference counts:
+// addRef() and dropRef() are lock-free. Each slot keeps its generation and its
+// count in one atomic word, so a count can only change while the id that was
+// passed in is still current. A block whose count drops to zero can't be
+// revived; its slot is pushed onto a lock-free reclaim list for the owner to
+// free under its mutex.
+class BlockTable {
+public:
+    static constexpr int kIndexBits = 20;
+    static constexpr int kGenerationBits = 31 - kIndexBits;
+    static constexpr uint32_t kMaxSlots = uint32_t(1) << kIndexBits;
+    static constexpr uint32_t kMaxGeneration = (uint32_t(1) << kGenerationBits) - 1;    // Then back to 1
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    // Slot flags
+    static constexpr uint8_t kOccupied = 1 << 0;   // Slot holds a block's metadata
+    static constexpr uint8_t kInUse = 1 << 1;      // Block is live (not freed yet)
+    static constexpr uint8_t kMoving = 1 << 2;     // Being copied by concurrent compaction
+    static constexpr uint8_t kMoveDirty = 1 << 3;  // Written while moving; the copy is stale
+
+    explicit BlockTable(uint32_t index_base = 0, uint32_t max_slots = kMaxSlots);
+    ~BlockTable();
+
+    // Stores a new live block with refs references (at least one) and returns
+    // its id, or -1 if every slot is taken
+    int insert(size_t offset, size_t size, uint32_t type_id, uint32_t alloc_handle, uint32_t refs = 1);
+
+    // Drops the metadata of a slot; ids that referred to it become invalid
+    void remove(uint32_t slot);
+
+    // Resolves an id to its slot. Fails for unknown, removed or recycled ids.
+    bool find(int id, uint32_t& slot) const {
+        uint32_t generation;
+        if (!locate(id, slot, generation)) {
+            return false;
+        }
+        uint32_t i = slot & (kChunkSize - 1);
+        const Chunk& chunk = at(slot);
+        return (chunk.flags[i] & kOccupied) && generationOf(chunk.state[i].load(std::memory_order_relaxed)) == generation;
+    }
+
+    int idOf(uint32_t slot) const {
+        uint32_t generation = generationOf(at(slot).state[slot & (kChunkSize - 1)].load(std::memory_order_relaxed));
+        return static_cast<int>((generation << kIndexBits) | (index_base_ + slot));
+    }
+
+    // Lock-free reference counting by amount references. Both fail for stale
+    // ids and for blocks whose count already reached zero, dropRef also for
+    // more references than the block has, and report the new count. When
+    // dropRef brings it to zero the slot has been queued for takeReclaimed().
+    bool addRef(int id, int& count, uint32_t amount = 1);
+    bool dropRef(int id, int& count, uint32_t amount = 1);
+
+    // Detaches the reclaim list and calls f(slot) for every slot on it
+    template <typename F>
+    void takeReclaimed(F&& f) {
+        uint32_t slot = reclaim_head_.exchange(kNone, std::memory_order_acquire);
+        while (slot != kNone) {
+            uint32_t next = at(slot).reclaim_next[slot & (kChunkSize - 1)];
+            f(slot);
+            slot = next;
+        }
+    }
+
+    size_t& offset(uint32_t slot) { return at(slot).offset[slot & (kChunkSize - 1)]; }
+    size_t& size(uint32_t slot) { return at(slot).size[slot & (kChunkSize - 1)]; }
+    uint8_t& flags(uint32_t slot) { return at(slot).flags[slot & (kChunkSize - 1)]; }
+    uint32_t& allocHandle(uint32_t slot) { return at(slot).alloc_handle[slot & (kChunkSize - 1)]; }
+    uint32_t& typeId(uint32_t slot) { return at(slot).type_id[slot & (kChunkSize - 1)]; }
+
+    int refCount(uint32_t slot) const {
+        return static_cast<int>(countOf(at(slot).state[slot & (kChunkSize - 1)].load(std::memory_order_relaxed)));
+    }
+
+    bool inUse(uint32_t slot) { return flags(slot) & kInUse; }
+
+    // Number of blocks with metadata (live or freed but not yet removed)
+    size_t count() const { return count_; }
+
+    // Calls f(slot) for every occupied slot, in slot order
+    template <typename F>
+    void forEach(F&& f) {
+        uint32_t slot_count = slot_count_.load(std::memory_order_relaxed);
+        for (uint32_t slot = 0; slot < slot_count; slot++) {
+            if (flags(slot) & kOccupied) {
+                f(slot);
+            }
+        }
+    }
+
+private:
+    static constexpr int kChunkBits = 12;
+    static constexpr uint32_t kChunkSize = uint32_t(1) << kChunkBits;
+    static constexpr uint32_t kMaxChunks = kMaxSlots / kChunkSize;
+
+    struct Chunk {
+        size_t offset[kChunkSize];
+        size_t size[kChunkSize];
+        std::atomic<uint64_t> state[kChunkSize];    // generation << 32 | reference count
+        uint32_t alloc_handle[kChunkSize];
+        uint32_t type_id[kChunkSize];       // Resolved to a name by TypeRegistry
+        uint32_t reclaim_next[kChunkSize];  // Link in the reclaim list
+        uint8_t flags[kChunkSize];
+    };
+
+    static uint64_t pack(uint32_t generation, uint32_t count) { return uint64_t(generation) << 32 | count; }
+    static uint32_t generationOf(uint64_t state) { return static_cast<uint32_t>(state >> 32); }
+    static uint32_t countOf(uint64_t state) { return static_cast<uint32_t>(state); }
+
+    // Splits an id into slot and generation; only checks the slot is in range.
+    // Safe without the owner's mutex: chunks are published before slot_count_.
+    bool locate(int id, uint32_t& slot, uint32_t& generation) const {
+        if (id < 0) {
+            return false;
+        }
+        slot = (static_cast<uint32_t>(id) & (kMaxSlots - 1)) - index_base_;
+        generation = static_cast<uint32_t>(id) >> kIndexBits;
+        // Also catches ids below index_base_, which wrap around
+        return slot < slot_count_.load(std::memory_order_acquire);
+    }
+
+    Chunk& at(uint32_t slot) const { return *chunks_[slot >> kChunkBits]; }
+
+    std::unique_ptr<Chunk> chunks_[kMaxChunks];
+    uint32_t index_base_;               // Index of slot 0 in the ids
+    uint32_t max_slots_;
+    std::atomic<uint32_t> slot_count_;  // Slots handed out so far (high-water mark)
+    size_t count_;
+    std::deque<uint32_t> free_slots_;   // Removed slots, reused oldest first
+    std::atomic<uint32_t> reclaim_head_;    // Slots whose count reached zero
+};
+
+#endif //BLOCK_TABLE_H
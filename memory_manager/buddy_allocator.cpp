@@ -0,0 +1,95 @@
+// buddy_allocator.cpp
+#include "buddy_allocator.h"
+#include <bit>
+
+BuddyAllocator::BuddyAllocator(size_t pool_size)
+    : non_empty_(0), free_bytes_(0), free_block_count_(0) {
+    // Cover [0, pool_size) with the largest naturally aligned blocks that fit
+    size_t offset = 0;
+    while (pool_size - offset >= (size_t(1) << kMinOrder)) {
+        int order = kMaxOrder;
+        while (order > kMinOrder &&
+               ((offset & ((size_t(1) << order) - 1)) != 0 || offset + (size_t(1) << order) > pool_size)) {
+            order--;
+        }
+        pushFree(order, offset);
+        free_bytes_ += size_t(1) << order;
+        offset += size_t(1) << order;
+    }
+}
+
+bool BuddyAllocator::allocate(size_t size, size_t& offset, uint32_t& handle) {
+    if (size == 0) {
+        return false;
+    }
+
+    int order = orderFor(size);
+    if (order > kMaxOrder) {
+        return false;
+    }
+
+    // Smallest order with a free block that is large enough
+    uint64_t candidates = non_empty_ & (~uint64_t(0) << order);
+    if (candidates == 0) {
+        return false;
+    }
+    int current = std::countr_zero(candidates);
+
+    auto it = free_[current].begin();
+    size_t block = *it;
+    free_[current].erase(it);
+    free_block_count_--;
+    if (free_[current].empty()) {
+        non_empty_ &= ~(uint64_t(1) << current);
+    }
+
+    // Split down, keeping the upper half of each split free
+    while (current > order) {
+        current--;
+        pushFree(current, block ^ (size_t(1) << current));
+    }
+
+    free_bytes_ -= size_t(1) << order;
+    offset = block;
+    handle = static_cast<uint32_t>(order);
+    return true;
+}
+
+void BuddyAllocator::release(size_t offset, size_t /*size*/, uint32_t handle) {
+    int order = static_cast<int>(handle);
+    free_bytes_ += size_t(1) << order;
+
+    // Merge with the buddy for as long as it is free
+    while (order < kMaxOrder) {
+        size_t buddy = offset ^ (size_t(1) << order);
+        if (free_[order].erase(buddy) == 0) {
+            break;
+        }
+        free_block_count_--;
+        if (free_[order].empty()) {
+            non_empty_ &= ~(uint64_t(1) << order);
+        }
+        offset &= ~(size_t(1) << order);
+        order++;
+    }
+
+    pushFree(order, offset);
+}
+
+size_t BuddyAllocator::largestFreeExtent() const {
+    if (non_empty_ == 0) {
+        return 0;
+    }
+    return size_t(1) << (63 - std::countl_zero(non_empty_));
+}
+
+int BuddyAllocator::orderFor(size_t size) {
+    int order = static_cast<int>(std::bit_width(size - 1));
+    return order < kMinOrder ? kMinOrder : order;
+}
+
+void BuddyAllocator::pushFree(int order, size_t offset) {
+    free_[order].insert(offset);
+    non_empty_ |= uint64_t(1) << order;
+    free_block_count_++;
+}
@@ -0,0 +1,45 @@
+#ifndef BUDDY_ALLOCATOR_H
+#define BUDDY_ALLOCATOR_H
+
+#include "allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+
+// Binary buddy allocator.
+// Every allocation is a power-of-two block aligned to its own size, so the
+// buddy of the block at 'offset' with order k is simply offset ^ (1 << k).
+// Allocation splits a larger free block down to the requested order; release
+// merges with the buddy for as long as the buddy is free, at most one step per
+// order. Free blocks never need to be moved, so compaction is not supported.
+//
+// A pool that is not a power of two is covered by the largest aligned blocks
+// that fit; buddies that would fall past the end of the pool are never free.
+class BuddyAllocator : public Allocator {
+public:
+    explicit BuddyAllocator(size_t pool_size);
+
+    bool allocate(size_t size, size_t& offset, uint32_t& handle) override;
+    void release(size_t offset, size_t size, uint32_t handle) override;
+    bool slideDown(size_t& /*offset*/, size_t /*size*/, uint32_t /*handle*/) override { return false; }
+    bool supportsCompaction() const override { return false; }
+
+    size_t freeBytes() const override { return free_bytes_; }
+    size_t freeExtentCount() const override { return free_block_count_; }
+    size_t largestFreeExtent() const override;
+    const char* name() const override { return "buddy"; }
+
+private:
+    static constexpr int kMinOrder = 4;     // 16-byte blocks
+    static constexpr int kMaxOrder = 48;
+
+    static int orderFor(size_t size);
+    void pushFree(int order, size_t offset);
+
+    std::unordered_set<size_t> free_[kMaxOrder + 1];  // Free block offsets per order
+    uint64_t non_empty_;                              // Bit k set = free_[k] not empty
+    size_t free_bytes_;
+    size_t free_block_count_;
+};
+
+#endif //BUDDY_ALLOCATOR_H
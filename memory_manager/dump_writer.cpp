@@ -0,0 +1,234 @@
+// dump_writer.cpp
+#include "dump_writer.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+const char* changeOpName(ChangeEvent::Op op) {
+    switch (op) {
+        case ChangeEvent::CREATE: return "CREATE";
+        case ChangeEvent::SET: return "SET";
+        case ChangeEvent::ADD_REF: return "ADD_REF";
+        case ChangeEvent::DROP_REF: return "DROP_REF";
+        case ChangeEvent::FREE: return "FREE";
+        case ChangeEvent::MOVE: return "MOVE";
+        case ChangeEvent::REMOVE: return "REMOVE";
+    }
+    return "UNKNOWN";
+}
+
+std::string dumpFileName(const std::string& dump_folder, std::chrono::system_clock::time_point timestamp) {
+    auto time = std::chrono::system_clock::to_time_t(timestamp);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()) % 1000;
+
+    std::stringstream filename;
+    filename << dump_folder << "/mem_dump_";
+    filename << std::put_time(std::localtime(&time), "%Y%m%d_%H%M%S");
+    filename << "_" << std::setfill('0') << std::setw(3) << ms.count() << ".txt";
+    return filename.str();
+}
+
+void writeDumpText(std::ostream& out, const DumpSnapshot& snapshot, const std::vector<ChangeEvent>& changes,
+                   size_t lost, const TypeRegistry& types) {
+    auto now_time = std::chrono::system_clock::to_time_t(snapshot.timestamp);
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     snapshot.timestamp.time_since_epoch()) % 1000;
+
+    out << "Memory Dump - "
+        << std::put_time(std::localtime(&now_time), "%Y-%m-%d %H:%M:%S")
+        << "." << std::setfill('0') << std::setw(3) << now_ms.count() << std::setfill(' ') << "\n\n";
+
+    // Every change since the previous dump, with the time it was made
+    if (!changes.empty() || lost != 0) {
+        out << "Changes:\n";
+        for (const ChangeEvent& change : changes) {
+            auto change_time = std::chrono::system_clock::to_time_t(change.timestamp);
+            auto change_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                change.timestamp.time_since_epoch()) % 1000;
+            out << "  " << std::put_time(std::localtime(&change_time), "%H:%M:%S")
+                << "." << std::setfill('0') << std::setw(3) << change_ms.count() << std::setfill(' ')
+                << "\t" << changeOpName(change.op) << "\tID " << change.id;
+            if (change.op == ChangeEvent::ADD_REF || change.op == ChangeEvent::DROP_REF) {
+                out << "\tref count " << change.ref_count << "\n";
+            } else {
+                out << "\toffset " << change.offset << "\tsize " << change.size
+                    << "\t" << types.nameOf(change.type_id)
+                    << "\tref count " << change.ref_count << "\n";
+            }
+        }
+        if (lost != 0) {
+            out << "  (" << lost << " more change(s) not listed, the dump queue was full)\n";
+        }
+        out << "\n";
+    }
+
+    size_t free_bytes = 0;
+    size_t block_count = 0;
+    for (const DumpSnapshot::Shard& shard : snapshot.shards) {
+        free_bytes += shard.free_bytes;
+        block_count += shard.block_count;
+    }
+
+    out << "Total Memory: " << snapshot.memory_size << " bytes\n";
+    out << "Allocator: " << snapshot.allocator << "\n";
+    out << "Free Memory: " << free_bytes << " bytes in " << snapshot.free_extents << " extent(s)\n";
+    if (snapshot.shards.size() > 1) {
+        out << "Shards: " << snapshot.shards.size() << "\n";
+        for (size_t i = 0; i < snapshot.shards.size(); i++) {
+            out << "  Shard " << i << ": offset " << snapshot.shards[i].offset
+                << ", " << snapshot.shards[i].size << " bytes, "
+                << snapshot.shards[i].free_bytes << " free, "
+                << snapshot.shards[i].block_count << " block(s)\n";
+        }
+    }
+    out << "Block Count: " << block_count << "\n\n";
+
+    out << "Blocks:\n";
+    out << "-------------------------------------------------------------------------\n";
+    out << "ID\tOffset\tSize\tType\tRef Count\tStatus\n";
+    out << "-------------------------------------------------------------------------\n";
+
+    for (const DumpSnapshot::Block& block : snapshot.blocks) {
+        out << block.id << "\t"
+            << block.offset << "\t"
+            << block.size << "\t"
+            << types.nameOf(block.type_id) << "\t"
+            << block.ref_count << "\t\t"
+            << (block.in_use ? "In Use" : "Free") << "\n";
+    }
+
+    out << "-------------------------------------------------------------------------\n\n";
+
+    out << "Memory Map (showing first 100 bytes or until end):\n";
+    out << "-------------------------------------------------------------------------\n";
+
+    size_t display_size = std::min(snapshot.memory_size, static_cast<size_t>(100));
+    std::vector<int> owners(display_size, -1);
+    for (const DumpSnapshot::Block& block : snapshot.blocks) {
+        if (!block.in_use) {
+            continue;
+        }
+        size_t end = std::min(block.offset + block.size, display_size);
+        for (size_t i = block.offset; i < end; i++) {
+            owners[i] = block.id;
+        }
+    }
+
+    for (size_t i = 0; i < display_size; i++) {
+        if (owners[i] >= 0) {
+            out << "[" << owners[i] << "]";
+        } else {
+            out << "[ ]";
+        }
+
+        if ((i + 1) % 10 == 0) {
+            out << "\n";
+        }
+    }
+}
+
+DumpWriter::DumpWriter(WriteFunction write, size_t capacity, std::chrono::milliseconds coalesce_window)
+    : write_(std::move(write)), coalesce_window_(coalesce_window),
+      cells_(std::make_unique<Cell[]>(capacity)), mask_(capacity - 1) {
+    if (capacity == 0 || (capacity & mask_) != 0) {
+        throw std::invalid_argument("Dump queue capacity must be a power of two");
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    thread_ = std::thread([this]() { run(); });
+}
+
+DumpWriter::~DumpWriter() {
+    stop();
+}
+
+// Bounded multi-producer ring: each cell's sequence says whose turn it is.
+// sequence == pos: free for the producer claiming pos.
+// sequence == pos + 1: holds the event for the consumer at pos.
+void DumpWriter::push(const ChangeEvent& event) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells_[pos & mask_];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+        if (diff == 0) {
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            lost_.fetch_add(1, std::memory_order_relaxed);  // Full: the writer is behind
+            cell = nullptr;
+            break;
+        } else {
+            pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    if (cell) {
+        cell->event = event;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+    }
+
+    // Only wake the writer when it is actually waiting
+    if (idle_.load() && idle_.exchange(false)) {
+        idle_.notify_one();
+    }
+}
+
+bool DumpWriter::pop(ChangeEvent& event) {
+    Cell& cell = cells_[dequeue_pos_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+        return false;
+    }
+    event = cell.event;
+    cell.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+    dequeue_pos_++;
+    return true;
+}
+
+void DumpWriter::stop() {
+    if (running_.exchange(false)) {
+        idle_.store(false);
+        idle_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+}
+
+void DumpWriter::run() {
+    std::vector<ChangeEvent> changes;
+    while (true) {
+        // Sleep until a producer flips idle_ back. Checking the ring after
+        // setting the flag closes the window where a push would go unnoticed.
+        idle_.store(true);
+        size_t pending = enqueue_pos_.load() - dequeue_pos_;
+        if (pending == 0 && lost_.load() == 0 && running_.load()) {
+            idle_.wait(true);
+        }
+        idle_.store(false);
+
+        bool stopping = !running_.load();
+        if (!stopping) {
+            // Let the rest of the burst arrive so it ends up in the same file
+            std::this_thread::sleep_for(coalesce_window_);
+        }
+
+        changes.clear();
+        ChangeEvent event;
+        while (pop(event)) {
+            changes.push_back(event);
+        }
+        size_t lost = lost_.exchange(0);
+        if (!changes.empty() || lost != 0) {
+            write_(changes, lost);
+        }
+
+        if (stopping) {
+            return;
+        }
+    }
+}
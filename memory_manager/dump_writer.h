@@ -0,0 +1,114 @@
+#ifndef DUMP_WRITER_H
+#define DUMP_WRITER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "type_registry.h"
+
+// One change to the memory state, as recorded by the request that made it.
+// Offsets are relative to the start of the memory pool.
+struct ChangeEvent {
+    enum Op : uint8_t { CREATE, SET, ADD_REF, DROP_REF, FREE, MOVE, REMOVE };
+
+    std::chrono::system_clock::time_point timestamp;
+    Op op;
+    int id;
+    size_t offset;
+    size_t size;
+    int ref_count;
+    uint32_t type_id;
+};
+
+const char* changeOpName(ChangeEvent::Op op);
+
+// Metadata of the whole memory at one point in time, as shown in a dump file.
+// Offsets are relative to the start of the memory pool.
+struct DumpSnapshot {
+    struct Block {
+        int id;
+        size_t offset;
+        size_t size;
+        uint32_t type_id;
+        int ref_count;
+        bool in_use;
+    };
+    struct Shard {
+        size_t offset;
+        size_t size;
+        size_t free_bytes;
+        size_t block_count;
+    };
+
+    std::chrono::system_clock::time_point timestamp;
+    size_t memory_size = 0;
+    std::string allocator;
+    size_t free_extents = 0;
+    std::vector<Shard> shards;
+    std::vector<Block> blocks;
+};
+
+// Path of the text dump for a given time: DUMP_FOLDER/mem_dump_YYYYMMDD_HHMMSS_sss.txt
+std::string dumpFileName(const std::string& dump_folder, std::chrono::system_clock::time_point timestamp);
+
+// Formats a dump file: the changes it covers, if any, then the snapshot
+void writeDumpText(std::ostream& out, const DumpSnapshot& snapshot, const std::vector<ChangeEvent>& changes,
+                   size_t lost, const TypeRegistry& types);
+
+// Writes dump files on a background thread instead of on the request path.
+//
+// Requests only push a ChangeEvent into a bounded lock-free ring, which never
+// blocks and never takes a lock. The writer thread wakes up on the first event,
+// waits 'coalesce_window' for the rest of the burst, and hands everything it
+// collected to 'write' in one call, which produces a single dump file listing
+// every change with its own timestamp.
+//
+// When the ring is full the event itself is lost but still counted, and a dump
+// is still written afterwards: the snapshot taken by 'write' always reflects
+// every change.
+class DumpWriter {
+public:
+    using WriteFunction = std::function<void(const std::vector<ChangeEvent>& changes, size_t lost)>;
+
+    static constexpr size_t kDefaultCapacity = 4096;   // Must be a power of two
+    static constexpr std::chrono::milliseconds kDefaultCoalesceWindow{20};
+
+    DumpWriter(WriteFunction write, size_t capacity = kDefaultCapacity,
+               std::chrono::milliseconds coalesce_window = kDefaultCoalesceWindow);
+    ~DumpWriter();
+
+    // Safe from any thread, including while holding a shard mutex
+    void push(const ChangeEvent& event);
+
+    // Writes whatever is still queued and joins the writer thread
+    void stop();
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        ChangeEvent event;
+    };
+
+    bool pop(ChangeEvent& event);   // Writer thread only
+    void run();
+
+    WriteFunction write_;
+    std::chrono::milliseconds coalesce_window_;
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    std::atomic<size_t> enqueue_pos_{0};
+    size_t dequeue_pos_ = 0;
+    std::atomic<size_t> lost_{0};
+    std::atomic<bool> idle_{false};     // Writer is (about to be) waiting for an event
+    std::atomic<bool> running_{true};
+    std::thread thread_;
+};
+
+#endif //DUMP_WRITER_H
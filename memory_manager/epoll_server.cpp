@@ -0,0 +1,377 @@
+// epoll_server.cpp
+#include "epoll_server.h"
+
+#ifdef __linux__
+
+#include "../protocol/frame_io.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kMaxEvents = 64;
+constexpr size_t kReadChunk = 64 * 1024;
+
+std::runtime_error socketError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+}
+
+EpollServer::Connection::~Connection() {
+    ::close(fd);
+}
+
+EpollServer::EpollServer(int port, MemoryManager* memory_manager, size_t workers)
+    : port_(port), handler_(memory_manager), worker_count_(workers), running_(false) {
+}
+
+EpollServer::~EpollServer() {
+    stop();
+}
+
+void EpollServer::start() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw socketError("Failed to create socket");
+    }
+
+    int opt = 1;
+    if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        throw socketError("Failed to set socket options");
+    }
+    setNoDelay(listen_fd_);     // Accepted sockets inherit it
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port_);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        throw socketError("Failed to bind socket");
+    }
+    if (listen(listen_fd_, SOMAXCONN) < 0) {
+        throw socketError("Failed to listen");
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        throw socketError("Failed to create epoll instance");
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &event);
+    event.events = EPOLLIN;
+    event.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+
+    std::cout << "Socket server listening on port " << port_ << " (epoll, "
+              << worker_count_ << " worker(s))" << std::endl;
+
+    running_ = true;
+    event_thread_ = std::thread(&EpollServer::runEventLoop, this);
+    for (size_t i = 0; i < worker_count_; i++) {
+        workers_.emplace_back(&EpollServer::runWorker, this);
+    }
+}
+
+void EpollServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        std::cerr << "[EpollServer] Failed to wake the event loop: " << std::strerror(errno) << std::endl;
+    }
+    if (event_thread_.joinable()) {
+        event_thread_.join();
+    }
+
+    ready_cv_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    ready_.clear();
+
+    ::close(listen_fd_);
+    ::close(epoll_fd_);
+    ::close(wake_fd_);
+    listen_fd_ = epoll_fd_ = wake_fd_ = -1;
+}
+
+NetworkStats EpollServer::stats() const {
+    return {requests_.load(), syscalls_.load()};
+}
+
+void EpollServer::runEventLoop() {
+    epoll_event events[kMaxEvents];
+    while (running_) {
+        int count = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+        syscalls_++;
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[EpollServer] epoll_wait failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd_) {
+                continue;   // stop() was called; running_ is already false
+            }
+            if (fd == listen_fd_) {
+                acceptConnections();
+                continue;
+            }
+
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) {
+                continue;
+            }
+            std::shared_ptr<Connection> connection = it->second;
+
+            // Reading also detects the hang-up, after taking the last requests
+            bool open = !(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) ||
+                        readFrom(connection);
+            if (open) {
+                std::lock_guard<std::mutex> lock(connection->mutex);
+                if (events[i].events & EPOLLOUT) {
+                    open = flush(*connection);
+                }
+                open = open && !finished(*connection);
+            }
+            if (!open) {
+                close(connection);
+            }
+        }
+    }
+
+    // Workers may still hold some connections; each closes its socket when the last one lets go
+    for (auto& entry : connections_) {
+        std::lock_guard<std::mutex> lock(entry.second->mutex);
+        entry.second->closed = true;
+    }
+    connections_.clear();
+}
+
+void EpollServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        syscalls_++;
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Failed to accept client connection: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        // Edge-triggered: one event per transition, so the handlers always drain
+        // the socket (reads) or the output buffer (writes) until EAGAIN
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        syscalls_++;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            std::cerr << "[EpollServer] Failed to watch socket " << fd << ": " << std::strerror(errno) << std::endl;
+            ::close(fd);
+            continue;
+        }
+        connections_[fd] = std::make_shared<Connection>(fd);
+        std::cout << "Client connected" << std::endl;
+    }
+}
+
+bool EpollServer::readFrom(const std::shared_ptr<Connection>& connection) {
+    std::vector<char>& input = connection->input;
+    bool hang_up = false;
+    bool end_of_input = false;
+    while (true) {
+        size_t used = input.size();
+        input.resize(used + kReadChunk);
+        ssize_t received = recv(connection->fd, input.data() + used, kReadChunk, 0);
+        syscalls_++;
+        input.resize(used + (received > 0 ? received : 0));
+        if (received > 0) {
+            continue;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received == 0) {
+            end_of_input = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            std::cerr << "Error receiving from socket " << connection->fd << ": " << std::strerror(errno) << std::endl;
+            hang_up = true;
+        }
+        break;
+    }
+
+    // Cut the complete frames: a 4-byte length, then that many bytes of message
+    std::deque<std::vector<char>> frames;
+    size_t position = 0;
+    while (input.size() - position >= sizeof(int)) {
+        int length;
+        std::memcpy(&length, input.data() + position, sizeof(int));
+        if (length < 0) {
+            std::cerr << "[EpollServer] Invalid frame length " << length << " on socket " << connection->fd << std::endl;
+            hang_up = true;
+            break;
+        }
+        if (input.size() - position - sizeof(int) < static_cast<size_t>(length)) {
+            break;
+        }
+        auto begin = input.begin() + position + sizeof(int);
+        frames.emplace_back(begin, begin + length);
+        position += sizeof(int) + length;
+    }
+    input.erase(input.begin(), input.begin() + position);
+
+    if (hang_up) {
+        return false;
+    }
+
+    // The client may have shut down only its sending side after pipelining its
+    // last requests: those are still served, and the connection closes once
+    // every response is out
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        if (end_of_input && !connection->draining) {
+            std::cout << "Client disconnected" << std::endl;
+            connection->draining = true;
+        }
+        if (!frames.empty()) {
+            for (auto& frame : frames) {
+                connection->requests.push_back(std::move(frame));
+            }
+            schedule = !connection->scheduled;
+            connection->scheduled = true;
+        }
+    }
+    if (schedule) {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        ready_.push_back(connection);
+        ready_cv_.notify_one();
+    }
+    return true;
+}
+
+void EpollServer::close(const std::shared_ptr<Connection>& connection) {
+    {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        connection->closed = true;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+    syscalls_++;
+    connections_.erase(connection->fd);
+}
+
+void EpollServer::runWorker() {
+    std::vector<char> response;
+    while (true) {
+        std::shared_ptr<Connection> connection;
+        {
+            std::unique_lock<std::mutex> lock(ready_mutex_);
+            ready_cv_.wait(lock, [this]() { return !ready_.empty() || !running_; });
+            if (ready_.empty()) {
+                return;
+            }
+            connection = std::move(ready_.front());
+            ready_.pop_front();
+        }
+
+        std::vector<char> frame;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            if (connection->closed || connection->requests.empty()) {
+                connection->scheduled = false;
+                continue;
+            }
+            frame = std::move(connection->requests.front());
+            connection->requests.pop_front();
+        }
+
+        // Encoded straight into this worker's reusable buffer, framed, in the request's format
+        response.clear();
+        size_t frame_start = beginFrame(response);
+        try {
+            handler_.process(MessageView::decode(frame), response);
+        } catch (const std::exception& e) {
+            std::cerr << "[EpollServer] Failed to process request on socket " << connection->fd << ": " << e.what() << std::endl;
+            response.resize(frame_start + sizeof(int));
+            Message::appendResponse(response, MessageView::formatOf(frame), 0, false);
+        }
+        endFrame(response, frame_start);
+        requests_++;
+
+        bool more = false;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            if (!connection->closed) {
+                std::vector<char>& output = connection->output;
+                output.insert(output.end(), response.begin(), response.end());
+                if (!flush(*connection)) {
+                    // Only the event loop closes; this makes it see a hang-up
+                    shutdown(connection->fd, SHUT_RDWR);
+                }
+            }
+
+            // One request per turn, so a busy client can't hold a worker
+            more = !connection->closed && !connection->requests.empty();
+            connection->scheduled = more;
+            if (!connection->closed && finished(*connection)) {
+                // Last response of a client that stopped sending: wake the event loop to close
+                shutdown(connection->fd, SHUT_RDWR);
+            }
+        }
+        if (more) {
+            std::lock_guard<std::mutex> lock(ready_mutex_);
+            ready_.push_back(std::move(connection));
+            ready_cv_.notify_one();
+        }
+    }
+}
+
+bool EpollServer::finished(const Connection& connection) {
+    return connection.draining && !connection.scheduled && connection.output.empty();
+}
+
+bool EpollServer::flush(Connection& connection) {
+    std::vector<char>& output = connection.output;
+    while (connection.output_sent < output.size()) {
+        ssize_t sent = send(connection.fd, output.data() + connection.output_sent,
+                            output.size() - connection.output_sent, MSG_NOSIGNAL);
+        syscalls_++;
+        if (sent > 0) {
+            connection.output_sent += sent;
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;    // Socket full: EPOLLOUT fires once it drains
+        } else {
+            return false;
+        }
+    }
+    output.clear();
+    connection.output_sent = 0;
+    return true;
+}
+
+#endif //__linux__
@@ -0,0 +1,89 @@
+#ifndef EPOLL_SERVER_H
+#define EPOLL_SERVER_H
+
+#ifdef __linux__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "network_server.h"
+#include "request_handler.h"
+
+class MemoryManager;
+
+// Event-driven backend for Linux. The thread count is fixed (one event loop
+// plus 'workers' request threads) no matter how many clients are connected.
+//
+// The event loop owns every socket. Sockets are non-blocking and registered
+// edge-triggered, so on each readiness event the loop reads until EAGAIN into
+// the connection's input buffer and cuts complete length-prefixed frames off
+// it. Frames are queued on their connection, and the connection is handed to
+// the worker pool. A connection is served by one worker at a time, so its
+// responses go out in request order.
+//
+// Workers append responses to the connection's output buffer and send what
+// the socket takes right away; whatever is left is sent by the event loop when
+// the socket becomes writable again.
+class EpollServer : public NetworkServer {
+public:
+    EpollServer(int port, MemoryManager* memory_manager, size_t workers);
+    ~EpollServer() override;
+
+    void start() override;
+    void stop() override;
+    NetworkStats stats() const override;
+
+private:
+    struct Connection {
+        explicit Connection(int fd) : fd(fd) {}
+        ~Connection();              // Closes fd, once no worker can still use it
+
+        int fd;
+        std::vector<char> input;    // Event loop only
+
+        std::mutex mutex;           // Guards everything below
+        std::deque<std::vector<char>> requests;     // Complete frames, without the length prefix
+        bool scheduled = false;     // Queued for or being served by a worker
+        bool closed = false;
+        bool draining = false;      // The client stopped sending; close once it has every response
+        std::vector<char> output;   // Not sent yet
+        size_t output_sent = 0;
+    };
+
+    void runEventLoop();
+    void runWorker();
+    void acceptConnections();
+    bool readFrom(const std::shared_ptr<Connection>& connection);   // False if the socket failed
+    void close(const std::shared_ptr<Connection>& connection);
+    bool flush(Connection& connection);     // Needs connection.mutex; false if the socket failed
+    static bool finished(const Connection& connection);    // Needs connection.mutex; nothing left to answer or send
+
+    int port_;
+    RequestHandler handler_;
+    size_t worker_count_;
+    std::atomic<bool> running_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;              // eventfd that interrupts epoll_wait on stop()
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> syscalls_{0};
+
+    std::unordered_map<int, std::shared_ptr<Connection>> connections_;     // Event loop only
+
+    std::mutex ready_mutex_;
+    std::condition_variable ready_cv_;
+    std::deque<std::shared_ptr<Connection>> ready_;     // Connections with requests to serve
+
+    std::thread event_thread_;
+    std::vector<std::thread> workers_;
+};
+
+#endif //__linux__
+
+#endif //EPOLL_SERVER_H
@@ -0,0 +1,105 @@
+// free_list_allocator.cpp
+#include "free_list_allocator.h"
+#include <iterator>
+
+FreeListAllocator::FreeListAllocator(size_t pool_size) : free_bytes_(0) {
+    if (pool_size > 0) {
+        insertExtent(0, pool_size);
+        free_bytes_ = pool_size;
+    }
+}
+
+bool FreeListAllocator::allocate(size_t size, size_t& offset, uint32_t& handle) {
+    if (size == 0) {
+        return false;
+    }
+
+    // Smallest extent with at least 'size' bytes (ties broken by lowest offset)
+    auto fit = by_size_.lower_bound({size, 0});
+    if (fit == by_size_.end()) {
+        return false;
+    }
+
+    size_t extent_offset = fit->second;
+    size_t extent_size = fit->first;
+    eraseExtent(by_offset_.find(extent_offset));
+
+    // Keep the remainder of the extent in the index
+    if (extent_size > size) {
+        insertExtent(extent_offset + size, extent_size - size);
+    }
+
+    free_bytes_ -= size;
+    offset = extent_offset;
+    handle = 0;
+    return true;
+}
+
+void FreeListAllocator::release(size_t offset, size_t size, uint32_t /*handle*/) {
+    if (size == 0) {
+        return;
+    }
+
+    size_t start = offset;
+    size_t end = offset + size;
+
+    // Merge with the extent that ends where this one starts
+    auto next = by_offset_.lower_bound(offset);
+    if (next != by_offset_.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            start = prev->first;
+            eraseExtent(prev);
+        }
+    }
+
+    // Merge with the extent that starts where this one ends
+    if (next != by_offset_.end() && next->first == end) {
+        end += next->second;
+        eraseExtent(next);
+    }
+
+    insertExtent(start, end - start);
+    free_bytes_ += size;
+}
+
+bool FreeListAllocator::slideDown(size_t& offset, size_t size, uint32_t /*handle*/) {
+    auto next = by_offset_.lower_bound(offset);
+    if (next == by_offset_.begin()) {
+        return false;
+    }
+
+    auto gap = std::prev(next);
+    if (gap->first + gap->second != offset) {
+        return false;  // No free space directly below this extent
+    }
+
+    size_t new_offset = gap->first;
+    eraseExtent(gap);
+
+    // The gap now sits right after the moved extent; merge it with whatever follows
+    size_t start = new_offset + size;
+    size_t end = offset + size;
+    if (next != by_offset_.end() && next->first == end) {
+        end += next->second;
+        eraseExtent(next);
+    }
+    insertExtent(start, end - start);
+
+    offset = new_offset;
+    return true;
+}
+
+size_t FreeListAllocator::largestFreeExtent() const {
+    return by_size_.empty() ? 0 : by_size_.rbegin()->first;
+}
+
+void FreeListAllocator::insertExtent(size_t offset, size_t size) {
+    by_offset_.emplace(offset, size);
+    by_size_.emplace(size, offset);
+}
+
+void FreeListAllocator::eraseExtent(std::map<size_t, size_t>::iterator it) {
+    by_size_.erase({it->second, it->first});
+    by_offset_.erase(it);
+}
@@ -0,0 +1,42 @@
+#ifndef FREE_LIST_ALLOCATOR_H
+#define FREE_LIST_ALLOCATOR_H
+
+#include "allocator.h"
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+
+// Free-space index over the memory pool.
+// Every free extent is stored twice: by offset, so a released extent can be
+// merged with its neighbours, and by (size, offset), so allocate() can take the
+// smallest extent that fits. Allocation, release and coalescing are O(log n)
+// in the number of free extents. Handles are unused.
+class FreeListAllocator : public Allocator {
+public:
+    explicit FreeListAllocator(size_t pool_size);
+
+    // Best-fit allocation. Returns false if no single free extent is large enough.
+    bool allocate(size_t size, size_t& offset, uint32_t& handle) override;
+
+    // Returns [offset, offset + size) to the index, merging it with adjacent free extents.
+    void release(size_t offset, size_t size, uint32_t handle) override;
+
+    // Slides into the free extent that ends exactly at 'offset'.
+    bool slideDown(size_t& offset, size_t size, uint32_t handle) override;
+
+    size_t freeBytes() const override { return free_bytes_; }
+    size_t freeExtentCount() const override { return by_offset_.size(); }
+    size_t largestFreeExtent() const override;
+    const char* name() const override { return "freelist"; }
+
+private:
+    void insertExtent(size_t offset, size_t size);
+    void eraseExtent(std::map<size_t, size_t>::iterator it);
+
+    std::map<size_t, size_t> by_offset_;            // offset -> size
+    std::set<std::pair<size_t, size_t>> by_size_;   // (size, offset)
+    size_t free_bytes_;
+};
+
+#endif //FREE_LIST_ALLOCATOR_H
@@ -7,8 +7,10 @@
 #include "memory_manager.h"
 #include <iostream>
 
-GarbageCollector::GarbageCollector(MemoryManager* memory_manager)
-    : memory_manager_(memory_manager), running_(false) {
+GarbageCollector::GarbageCollector(MemoryManager* memory_manager, CompactionBudget compaction_budget,
+                                   CompactionMode compaction_mode)
+    : memory_manager_(memory_manager), running_(false), compaction_budget_(compaction_budget),
+      compaction_mode_(compaction_mode) {
 }
 
 GarbageCollector::~GarbageCollector() {
@@ -35,36 +37,38 @@ void GarbageCollector::stop() {
 }
 
 void GarbageCollector::collectGarbage() {
-    // Acquire lock to safely access memory manager data
-    bool block_freed = false;
-    { // Scope for the lock guard
-        std::lock_guard<std::recursive_mutex> lock(memory_manager_->memory_mutex_);
-        // Iterate through all blocks managed by the MemoryManager
-        for (auto it = memory_manager_->blocks_.begin(); it != memory_manager_->blocks_.end(); ++it) {
-            // Check if the block is currently marked as in use but has a reference count of zero or less
-            if (it->second.in_use && it->second.ref_count <= 0) {
-                // Mark the block as no longer in use. It will be cleaned up later by compactMemory.
-                std::cout << "GC: Marking block ID " << it->first << " as free (ref count " << it->second.ref_count << ")." << std::endl;
-                it->second.in_use = false;
-                block_freed = true;
-            }
-        }
-        // Optional: Trigger a memory dump immediately after freeing blocks if needed for debugging
-        // if (block_freed) {
-        //     memory_manager_->dumpMemoryState();
-        // }
-    } // Lock guard goes out of scope, mutex is released
-
+    // Free the blocks whose reference count dropped to zero since the last run.
+    // Each shard is locked in turn; decreaseRefCount only queues them.
+    for (auto& shard : memory_manager_->shards_) {
+        memory_manager_->reclaim(*shard);
+    }
 
     // --- Defragmentation Logic ---
     // Keep track of runs to periodically trigger defragmentation
     static int run_count = 0;
     run_count++;
 
-    // Trigger defragmentation (compaction) every N runs (e.g., every 10 runs = 5 seconds)
-    // The compactMemory function internally handles acquiring the necessary mutex.
-    if (run_count % 10 == 0) {
+    // Trigger defragmentation (compaction) every N runs (e.g., every 10 runs = 5 seconds).
+    // Concurrent compaction doesn't stop requests, so it runs quietly on every pass.
+    if (compaction_mode_ == CompactionMode::CONCURRENT) {
+        compactIncrementally();
+    } else if (run_count % 10 == 0) {
         std::cout << "Garbage collector initiating periodic defragmentation..." << std::endl;
-        memory_manager_->compactMemory();
+        compactIncrementally();
+    }
+}
+
+void GarbageCollector::compactIncrementally() {
+    // A sliding step holds the memory mutex for at most one budget's worth of
+    // moves; a concurrent step only takes it around each move. The pause between
+    // steps lets the requests that queued up on the mutex run first, so no
+    // request waits for a whole pass.
+    auto step = [this]() {
+        return compaction_mode_ == CompactionMode::CONCURRENT
+                   ? memory_manager_->relocateStep(compaction_budget_)
+                   : memory_manager_->compactStep(compaction_budget_);
+    };
+    while (running_ && !step()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
\ No newline at end of file
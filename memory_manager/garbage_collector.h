@@ -10,12 +10,12 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
-
-class MemoryManager;
+#include "memory_manager.h"
 
 class GarbageCollector {
 public:
-    GarbageCollector(MemoryManager* memory_manager);
+    GarbageCollector(MemoryManager* memory_manager, CompactionBudget compaction_budget = {},
+                     CompactionMode compaction_mode = CompactionMode::SLIDING);
     ~GarbageCollector();
 
     void start();
@@ -25,6 +25,9 @@ private:
     MemoryManager* memory_manager_;
     std::atomic<bool> running_;
     std::thread collector_thread_;
+    CompactionBudget compaction_budget_;    // Limits of each compaction step
+    CompactionMode compaction_mode_;
 
     void collectGarbage();
+    void compactIncrementally();
 };
\ No newline at end of file
@@ -0,0 +1,193 @@
+// journal.cpp
+#include "journal.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr const char* kFilePrefix = "mem_journal_";
+constexpr const char* kFileSuffix = ".bin";
+constexpr size_t kBufferSize = 64 * 1024;
+
+// Sequence number of a journal file name, or false if it isn't one
+bool parseSequence(const std::string& name, uint64_t& sequence) {
+    std::string prefix = kFilePrefix;
+    std::string suffix = kFileSuffix;
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return false;
+    }
+    sequence = std::stoull(digits);
+    return true;
+}
+
+}
+
+JournalRecord JournalRecord::fromChange(const ChangeEvent& change) {
+    JournalRecord record{};
+    record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                              change.timestamp.time_since_epoch()).count();
+    switch (change.op) {
+        case ChangeEvent::CREATE: record.op = CREATE; break;
+        case ChangeEvent::SET: record.op = SET; break;
+        case ChangeEvent::ADD_REF: record.op = ADD_REF; break;
+        case ChangeEvent::DROP_REF: record.op = DROP_REF; break;
+        case ChangeEvent::FREE: record.op = FREE; break;
+        case ChangeEvent::MOVE: record.op = MOVE; break;
+        case ChangeEvent::REMOVE: record.op = REMOVE; break;
+    }
+    record.id = change.id;
+    record.offset = change.offset;
+    record.size = change.size;
+    record.ref_count = change.ref_count;
+    record.type_id = change.type_id;
+    return record;
+}
+
+Journal::Journal(const std::string& dump_folder, size_t memory_size, const std::string& allocator,
+                 size_t shard_count, size_t max_blocks, size_t file_records, size_t max_files)
+    : dump_folder_(dump_folder), header_{}, file_records_(file_records), max_files_(max_files),
+      buffer_(kBufferSize) {
+    // A CHECKPOINT record, every block, and room for the batch to make progress
+    if (file_records < max_blocks + 2) {
+        throw std::invalid_argument("Journal files of " + std::to_string(file_records) +
+                                    " records can't hold a checkpoint of " + std::to_string(max_blocks) + " blocks");
+    }
+    memcpy(header_.magic, kMagic, sizeof(kMagic));
+    header_.record_size = sizeof(JournalRecord);
+    header_.shard_count = static_cast<uint32_t>(shard_count);
+    header_.record_capacity = file_records;
+    header_.memory_size = memory_size;
+    strncpy(header_.allocator, allocator.c_str(), sizeof(header_.allocator) - 1);
+
+    types_file_ = std::fopen(typesFileName(dump_folder_).c_str(), "a");
+    if (!types_file_) {
+        throw std::runtime_error("Failed to open journal types file in " + dump_folder_);
+    }
+
+    // Continue after the files of earlier runs instead of overwriting them
+    uint64_t sequence = 0;
+    std::vector<std::string> files = listFiles(dump_folder_);
+    if (!files.empty()) {
+        parseSequence(std::filesystem::path(files.back()).filename().string(), sequence);
+        sequence++;
+    }
+    open(sequence);
+    if (!file_) {
+        throw std::runtime_error("Failed to create journal file " + fileName(sequence));
+    }
+}
+
+Journal::~Journal() {
+    if (file_) {
+        std::fclose(file_);
+    }
+    std::fclose(types_file_);
+}
+
+void Journal::append(const JournalRecord& record) {
+    if (!hasRoom(1)) {
+        rotate();
+    }
+    if (!file_) {
+        return;
+    }
+    std::fwrite(&record, sizeof(record), 1, file_);
+    written_++;
+}
+
+void Journal::flush() {
+    if (file_) {
+        std::fflush(file_);
+    }
+}
+
+void Journal::rotate() {
+    uint64_t next = header_.sequence + 1;
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    open(next);
+}
+
+void Journal::open(uint64_t sequence) {
+    std::string name = fileName(sequence);
+    header_.sequence = sequence;
+    written_ = 0;
+
+    // Write the header, then grow the file to its full size up front so
+    // appending never has to extend it
+    std::FILE* file = std::fopen(name.c_str(), "wb");
+    if (!file) {
+        std::cerr << "[Journal] Failed to create " << name << std::endl;
+        return;
+    }
+    bool ok = std::fwrite(&header_, sizeof(header_), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+    std::error_code error;
+    std::filesystem::resize_file(name, sizeof(JournalHeader) + file_records_ * sizeof(JournalRecord), error);
+    if (!ok || error) {
+        std::cerr << "[Journal] Failed to preallocate " << name << std::endl;
+        return;
+    }
+
+    file_ = std::fopen(name.c_str(), "r+b");
+    if (!file_) {
+        std::cerr << "[Journal] Failed to open " << name << std::endl;
+        return;
+    }
+    std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+    std::fseek(file_, sizeof(JournalHeader), SEEK_SET);
+    std::cout << "[Journal] Writing " << name << std::endl;
+
+    // Keep the newest max_files_ files, this one included
+    for (const std::string& old_file : listFiles(dump_folder_)) {
+        uint64_t old_sequence;
+        if (parseSequence(std::filesystem::path(old_file).filename().string(), old_sequence) &&
+            old_sequence + max_files_ <= sequence) {
+            std::filesystem::remove(old_file, error);
+        }
+    }
+}
+
+void Journal::addType(uint32_t type_id, const std::string& name) {
+    std::lock_guard<std::mutex> lock(types_mutex_);
+    std::fprintf(types_file_, "%08x %s\n", type_id, name.c_str());
+    std::fflush(types_file_);
+}
+
+std::string Journal::fileName(uint64_t sequence) const {
+    char number[32];
+    std::snprintf(number, sizeof(number), "%06llu", static_cast<unsigned long long>(sequence));
+    return dump_folder_ + "/" + kFilePrefix + number + kFileSuffix;
+}
+
+std::vector<std::string> Journal::listFiles(const std::string& dump_folder) {
+    std::vector<std::pair<uint64_t, std::string>> found;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(dump_folder, error)) {
+        uint64_t sequence;
+        if (parseSequence(entry.path().filename().string(), sequence)) {
+            found.emplace_back(sequence, entry.path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::string> files;
+    for (auto& file : found) {
+        files.push_back(file.second);
+    }
+    return files;
+}
+
+std::string Journal::typesFileName(const std::string& dump_folder) {
+    return dump_folder + "/mem_journal_types.txt";
+}
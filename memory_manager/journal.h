@@ -0,0 +1,106 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "dump_writer.h"
+
+// One journal entry. Records are fixed-size and written in the machine's byte
+// order; the journal is read back on the machine that wrote it.
+struct JournalRecord {
+    enum Op : uint8_t {
+        END = 0,        // Unwritten (zero-filled) part of a preallocated file
+        CREATE, SET, ADD_REF, DROP_REF, FREE, MOVE, REMOVE,
+        CHECKPOINT,     // Forget every block; the BLOCK records that follow are the whole state
+        BLOCK           // One block of a checkpoint
+    };
+    static constexpr uint8_t kInUse = 1 << 0;   // BLOCK records: block not freed yet
+
+    int64_t timestamp_us;   // Microseconds since the epoch (system clock)
+    uint8_t op;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t id;
+    uint64_t offset;        // From the start of the memory pool
+    uint64_t size;
+    int32_t ref_count;
+    uint32_t type_id;
+
+    static JournalRecord fromChange(const ChangeEvent& change);
+};
+static_assert(sizeof(JournalRecord) == 40, "JournalRecord must stay 40 bytes");
+
+// Start of every journal file, followed by 'record_capacity' records
+struct JournalHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t shard_count;
+    uint64_t record_capacity;
+    uint64_t memory_size;
+    uint64_t sequence;      // Number of the file; files are replayed in this order
+    char allocator[24];
+};
+static_assert(sizeof(JournalHeader) == 64, "JournalHeader must stay 64 bytes");
+
+// Append-only binary log of memory changes, an alternative to one text dump per
+// change (--dumpMode journal).
+//
+// Records go to DUMP_FOLDER/mem_journal_NNNNNN.bin. Each file is preallocated
+// to hold 'file_records' records and written through a stdio buffer that is
+// flushed once per batch. When a file is full the journal rotates to the next
+// number and deletes files older than the last 'max_files', so the journal uses
+// bounded disk space. The owner starts every file with a checkpoint, which
+// keeps each remaining file readable on its own; 'max_blocks' is the most
+// blocks a checkpoint can list, and a file too small to hold one along with
+// at least one change is rejected at construction.
+//
+// Type names are appended to DUMP_FOLDER/mem_journal_types.txt as
+// "<hex id> <name>" lines.
+//
+// Not thread-safe except addType(): records are written by the dump writer thread only.
+class Journal {
+public:
+    static constexpr char kMagic[8] = {'M', 'P', 'J', 'R', 'N', 'L', '0', '1'};
+    static constexpr size_t kDefaultFileRecords = size_t(1) << 21;     // 80 MB files
+    static constexpr size_t kDefaultMaxFiles = 8;
+
+    Journal(const std::string& dump_folder, size_t memory_size, const std::string& allocator,
+            size_t shard_count, size_t max_blocks, size_t file_records = kDefaultFileRecords,
+            size_t max_files = kDefaultMaxFiles);
+    ~Journal();
+
+    void append(const JournalRecord& record);  // Rotates first when the current file is full
+    void flush();
+
+    bool hasRoom(size_t records) const { return written_ + records <= file_records_; }
+    size_t room() const { return file_records_ - written_; }
+    bool atFileStart() const { return written_ == 0; }
+    void rotate();
+
+    void addType(uint32_t type_id, const std::string& name);
+
+    // Journal files in a folder, oldest first
+    static std::vector<std::string> listFiles(const std::string& dump_folder);
+    static std::string typesFileName(const std::string& dump_folder);
+
+private:
+    void open(uint64_t sequence);
+    std::string fileName(uint64_t sequence) const;
+
+    std::string dump_folder_;
+    JournalHeader header_;
+    size_t file_records_;
+    size_t max_files_;
+    std::FILE* file_ = nullptr;
+    size_t written_ = 0;            // Records in the current file
+    std::vector<char> buffer_;      // stdio buffer of file_
+
+    std::mutex types_mutex_;
+    std::FILE* types_file_ = nullptr;
+};
+
+#endif //JOURNAL_H
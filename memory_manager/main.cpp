@@ -4,7 +4,7 @@
 // main.cpp
 #include "memory_manager.h"
 #include "garbage_collector.h"
-#include "socket_server.h"
+#include "network_server.h"
 #include <iostream>
 #include <string>
 #include <filesystem>
@@ -12,7 +12,11 @@
 
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName
-              << " --port PORT --memsize SIZE_MB --dumpFolder DUMP_FOLDER" << std::endl;
+              << " --port PORT --memsize SIZE_MB --dumpFolder DUMP_FOLDER"
+              << " [--allocator freelist|tlsf|buddy] [--slabThreshold BYTES]"
+              << " [--compactStepBytes BYTES] [--compactStepMicros US]"
+              << " [--compactionMode sliding|concurrent] [--shards N]"
+              << " [--dumpMode text|journal] [--netBackend threads|epoll|io_uring] [--workers N]" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -20,6 +24,14 @@ int main(int argc, char* argv[]) {
     int port = 0;
     size_t memsize = 0;
     std::string dumpFolder;
+    AllocationPolicy allocator = AllocationPolicy::FREE_LIST;
+    size_t slabThreshold = kDefaultSlabThreshold;
+    CompactionBudget compactionBudget;
+    CompactionMode compactionMode = CompactionMode::SLIDING;
+    size_t shards = 1;
+    DumpMode dumpMode = DumpMode::TEXT;
+    NetworkBackend netBackend = NetworkBackend::THREADS;
+    size_t workers = 0;
 
     // Simple argument parsing
     for (int i = 1; i < argc; i += 2) {
@@ -36,6 +48,50 @@ int main(int argc, char* argv[]) {
             memsize = std::stoi(argv[i + 1]);
         } else if (arg == "--dumpFolder") {
             dumpFolder = argv[i + 1];
+        } else if (arg == "--allocator") {
+            if (!parseAllocationPolicy(argv[i + 1], allocator)) {
+                std::cerr << "Unknown allocator: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--slabThreshold") {
+            slabThreshold = std::stoul(argv[i + 1]);
+            if (slabThreshold > kMaxSlabThreshold) {
+                std::cerr << "Invalid slab threshold: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--compactStepBytes") {
+            compactionBudget.max_bytes = std::stoul(argv[i + 1]);
+        } else if (arg == "--compactStepMicros") {
+            compactionBudget.max_time = std::chrono::microseconds(std::stoul(argv[i + 1]));
+        } else if (arg == "--shards") {
+            shards = std::stoul(argv[i + 1]);
+            if (shards == 0 || shards > MemoryManager::kMaxShards) {
+                std::cerr << "Invalid shard count: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--compactionMode") {
+            if (!parseCompactionMode(argv[i + 1], compactionMode)) {
+                std::cerr << "Unknown compaction mode: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--dumpMode") {
+            if (!parseDumpMode(argv[i + 1], dumpMode)) {
+                std::cerr << "Unknown dump mode: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--netBackend") {
+            if (!parseNetworkBackend(argv[i + 1], netBackend)) {
+                std::cerr << "Unknown or unsupported network backend: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--workers") {
+            workers = std::stoul(argv[i + 1]);
         } else {
             std::cerr << "Unknown argument: " << arg << std::endl;
             printUsage(argv[0]);
@@ -55,22 +111,22 @@ int main(int argc, char* argv[]) {
 
     try {
         // Initialize memory manager
-        MemoryManager memoryManager(memsize, dumpFolder);
+        MemoryManager memoryManager(memsize, dumpFolder, allocator, slabThreshold, shards, dumpMode);
 
         // Start garbage collector
-        GarbageCollector garbageCollector(&memoryManager);
+        GarbageCollector garbageCollector(&memoryManager, compactionBudget, compactionMode);
         garbageCollector.start();
 
         // Start socket server
-        SocketServer server(port, &memoryManager);
-        server.start();
+        std::unique_ptr<NetworkServer> server = makeNetworkServer(netBackend, port, &memoryManager, workers);
+        server->start();
 
         std::cout << "Memory Manager running on port " << port << std::endl;
         std::cout << "Press Enter to quit..." << std::endl;
         std::cin.get();
 
         // Cleanup
-        server.stop();
+        server->stop();
         garbageCollector.stop();
 
     } catch (const std::exception& e) {
@@ -9,10 +9,42 @@
 #include <sstream>
 #include <iostream>
 #include <cstring>
-#include <algorithm> // Para std::sort
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Bytes of a block that relocateStep may be copying without the shard mutex
+// are read and written one relaxed atomic byte at a time, on both sides, so a
+// racing SET is not a data race. The copy can still mix old and new bytes;
+// kMoveDirty makes finishMove throw it away.
+void storeRelaxed(char* dest, const char* source, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        std::atomic_ref<char>(dest[i]).store(source[i], std::memory_order_relaxed);
+    }
+}
+
+void loadRelaxed(char* dest, char* source, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        dest[i] = std::atomic_ref<char>(source[i]).load(std::memory_order_relaxed);
+    }
+}
+
+}
+
+MemoryManager::Shard::Shard(char* pool, size_t size, uint32_t index_base, uint32_t max_slots,
+                            std::unique_ptr<Allocator> allocator)
+    : pool(pool), size(size), blocks(index_base, max_slots), allocator(std::move(allocator)) {
+}
 
-MemoryManager::MemoryManager(size_t size_mb, const std::string& dump_folder)
+MemoryManager::MemoryManager(size_t size_mb, const std::string& dump_folder,
+                             AllocationPolicy policy, size_t slab_threshold, size_t shard_count,
+                             DumpMode dump_mode)
     : memory_size_(size_mb * 1024 * 1024), dump_folder_(dump_folder) {
+    if (shard_count == 0 || shard_count > kMaxShards) {
+        throw std::invalid_argument("Invalid shard count: " + std::to_string(shard_count));
+    }
+
     // Allocate memory pool with a single malloc call
     memory_pool_ = static_cast<char*>(malloc(memory_size_));
     if (!memory_pool_) {
@@ -22,372 +54,760 @@ MemoryManager::MemoryManager(size_t size_mb, const std::string& dump_folder)
     // Initialize memory to zero
     memset(memory_pool_, 0, memory_size_);
 
-    std::cout << "Memory manager initialized with " << size_mb << "MB" << std::endl;
+    // Split the pool and the id index space evenly; the last shard takes the remainder
+    int shard_bits = 0;
+    while ((size_t(1) << shard_bits) < shard_count) {
+        shard_bits++;
+    }
+    shard_slot_bits_ = BlockTable::kIndexBits - shard_bits;
+    uint32_t slots_per_shard = uint32_t(1) << shard_slot_bits_;
+    size_t shard_size = memory_size_ / shard_count & ~size_t(15);
+    for (size_t i = 0; i < shard_count; i++) {
+        size_t base = i * shard_size;
+        size_t size = i + 1 == shard_count ? memory_size_ - base : shard_size;
+        shards_.push_back(std::make_unique<Shard>(memory_pool_ + base, size,
+                                                  static_cast<uint32_t>(i) * slots_per_shard, slots_per_shard,
+                                                  makeAllocator(policy, size, slab_threshold)));
+    }
+
+    if (dump_mode == DumpMode::JOURNAL) {
+        journal_ = std::make_unique<Journal>(dump_folder_, memory_size_, shards_[0]->allocator->name(), shard_count,
+                                             size_t(slots_per_shard) * shard_count);
+        dump_writer_ = std::make_unique<DumpWriter>(
+            [this](const std::vector<ChangeEvent>& changes, size_t lost) { writeJournal(changes, lost); });
+    } else {
+        dump_writer_ = std::make_unique<DumpWriter>(
+            [this](const std::vector<ChangeEvent>& changes, size_t lost) { writeDump(changes, lost); });
+    }
+
+    std::cout << "Memory manager initialized with " << size_mb << "MB ("
+              << shards_[0]->allocator->name() << " allocator, "
+              << shard_count << " shard(s))" << std::endl;
 }
 
 MemoryManager::~MemoryManager() {
+    // The writer reads the shards, so it has to be done before they go away
+    dump_writer_.reset();
+    journal_.reset();
+    shards_.clear();
     // Free the entire memory pool
     free(memory_pool_);
     memory_pool_ = nullptr;
 }
 
-int MemoryManager::create(size_t size, const std::string& type) {
-    std::lock_guard<std::recursive_mutex> lock(memory_mutex_);
-    std::cout << "[MemoryManager] Attempting to create block of size " << size << std::endl;
+MemoryManager::Shard* MemoryManager::shardOf(int id) {
+    if (id < 0) {
+        return nullptr;
+    }
+    size_t index = (static_cast<uint32_t>(id) & (BlockTable::kMaxSlots - 1)) >> shard_slot_bits_;
+    return index < shards_.size() ? shards_[index].get() : nullptr;
+}
 
-    size_t offset = 0;
-    bool found = false;
-
-    // --- Revised First-Fit Algorithm ---
-    std::cout << "[MemoryManager] Starting revised first-fit search..." << std::endl;
-    size_t current_offset = 0;
-    while (current_offset < memory_size_) {
-        // Check if current_offset is within an existing used block
-        bool occupied = false;
-        size_t occupying_block_end = current_offset;
-        int occupying_block_id = -1;
-        for (const auto& [id, block] : blocks_) {
-            if (block.in_use && block.offset <= current_offset && current_offset < block.offset + block.size) {
-                occupied = true;
-                occupying_block_end = block.offset + block.size;
-                occupying_block_id = id;
-                break;
-            }
-        }
+int MemoryManager::create(size_t size, uint32_t type_id, uint32_t weight) {
+    std::cout << "[MemoryManager] Attempting to create block of size " << size << std::endl;
 
-        if (occupied) {
-            // If occupied, skip past the occupying block
-            std::cout << "[MemoryManager] Offset " << current_offset << " is occupied by block " << occupying_block_id << ". Skipping to " << occupying_block_end << std::endl;
-            current_offset = occupying_block_end;
-            continue; // Check the next position immediately after the block
-        }
+    if (size == 0) {
+        std::cerr << "[MemoryManager] Refusing to create a block of size 0." << std::endl;
+        return -1;
+    }
 
-        // If not occupied, find the size of the contiguous free block starting at current_offset
-        size_t available_size = 0;
-        size_t check_offset = current_offset;
-        while (check_offset < memory_size_) {
-            bool next_byte_occupied = false;
-            for (const auto& [id, block] : blocks_) {
-                if (block.in_use && block.offset <= check_offset && check_offset < block.offset + block.size) {
-                    next_byte_occupied = true;
-                    break;
-                }
-            }
-            if (next_byte_occupied) {
-                break; // End of the contiguous free block
-            }
-            available_size++;
-            check_offset++;
-        }
-        std::cout << "[MemoryManager] Found free block at offset " << current_offset << " of size " << available_size << std::endl;
-
-        // Check if this free block is large enough
-        if (available_size >= size) {
-            offset = current_offset;
-            found = true;
-            std::cout << "[MemoryManager] Found suitable block at offset " << offset << std::endl;
-            break; // Exit the while loop, suitable block found
-        } else {
-            // Free block not large enough, move to the position after this free block
-            current_offset += available_size;
-            // If available_size was 0 (e.g., we hit the end of memory immediately), ensure we advance.
-            if (available_size == 0) {
-                current_offset++;
-            }
-        }
+    // Spread blocks round-robin; fall back to the other shards when one is full
+    size_t first = next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_.size();
+    int id = -1;
+    for (size_t i = 0; i < shards_.size() && id < 0; i++) {
+        id = createIn(*shards_[(first + i) % shards_.size()], size, type_id, weight);
     }
-    std::cout << "[MemoryManager] Finished first-fit search. Found: " << (found ? "Yes" : "No") << std::endl;
-    // --- End of Revised First-Fit Algorithm ---
-
-    if (!found) {
-        std::cout << "[MemoryManager] No suitable block found initially, attempting defragmentation..." << std::endl; // Log
-        // Try to defragment and retry
-        compactMemory();
-
-        // Simple allocation after defragmentation - find end of last block
-        std::cout << "[MemoryManager] Defragmentation complete, retrying allocation..." << std::endl; // Log
-        offset = 0;
-        for (const auto& [id, block] : blocks_) {
-            if (block.in_use) {
-                size_t block_end = block.offset + block.size;
-                if (block_end > offset) {
-                    offset = block_end;
-                }
-            }
-        }
+    return id;
+}
+
+int MemoryManager::createIn(Shard& shard, size_t size, uint32_t type_id, uint32_t weight) {
+    std::lock_guard<std::recursive_mutex> lock(shard.mutex);
+    Allocator& allocator = *shard.allocator;
 
-        // Check if we have enough space after all blocks
-        if (offset + size > memory_size_) {
-            std::cerr << "[MemoryManager] Out of memory even after defragmentation." << std::endl; // Log
-            return -1;  // Out of memory
+    // Ask the allocation policy for a free extent
+    size_t offset = 0;
+    uint32_t handle = 0;
+    if (!allocator.allocate(size, offset, handle) &&
+        !(reclaim(shard) && allocator.allocate(size, offset, handle))) {
+        if (allocator.freeBytes() < size || !allocator.supportsCompaction()) {
+            std::cerr << "[MemoryManager] Out of memory: " << allocator.freeBytes()
+                      << " bytes free, " << size << " requested." << std::endl;
+            return -1;
         }
-        std::cout << "[MemoryManager] Found space after defragmentation at offset " << offset << std::endl; // Log
-        found = true; // Mark as found since we allocated after defrag
-    }
 
-    // If we still haven't found space (e.g., defrag didn't help enough or wasn't needed but space check failed)
-    if (!found) {
-         std::cerr << "[MemoryManager] Failed to find or create space for the requested size." << std::endl;
-         return -1; // Should not happen if logic above is correct, but safeguard
+        // Enough free bytes but no single extent large enough: compact and retry
+        std::cout << "[MemoryManager] No free extent of " << size << " bytes (largest is "
+                  << allocator.largestFreeExtent() << "), attempting defragmentation..." << std::endl;
+        compactMemory(shard);
+
+        if (!allocator.allocate(size, offset, handle)) {
+            std::cerr << "[MemoryManager] Out of memory even after defragmentation." << std::endl;
+            return -1;
+        }
+        std::cout << "[MemoryManager] Found space after defragmentation at offset " << offset << std::endl;
     }
 
     // Create new memory block
-    static int next_id = 1;
-    int id = next_id++;
-
-    blocks_[id] = {
-        .offset = offset,
-        .size = size,
-        .type = type,
-        .ref_count = 1,
-        .in_use = true
-    };
+    int id = shard.blocks.insert(offset, size, type_id, handle, weight);
+    if (id < 0) {
+        std::cerr << "[MemoryManager] Block table is full." << std::endl;
+        allocator.release(offset, size, handle);
+        return -1;
+    }
+    uint32_t slot;
+    shard.blocks.find(id, slot);
+    shard.live_blocks.emplace(offset, slot);
+    recordChange(ChangeEvent::CREATE, shard, slot);
     std::cout << "[MemoryManager] Created block ID " << id << " at offset " << offset << " size " << size << std::endl; // Add log
-
-    dumpMemoryState();
     return id;
 }
 
-bool MemoryManager::set(int id, const void* value, size_t size) {
-    std::lock_guard<std::recursive_mutex> lock(memory_mutex_);
+bool MemoryManager::registerType(uint32_t type_id, const std::string& name) {
+    bool known = types_.contains(type_id);
+    if (!types_.add(type_id, name)) {
+        std::cerr << "[MemoryManager] Type id " << type_id << " of '" << name
+                  << "' is already registered as '" << types_.nameOf(type_id) << "'." << std::endl;
+        return false;
+    }
+    if (journal_ && !known) {
+        journal_->addType(type_id, name);
+    }
+    return true;
+}
+
+bool MemoryManager::set(int id, const void* value, size_t size, size_t offset) {
+    Shard* shard = shardOf(id);
+    if (!shard) {
+        return false;
+    }
 
-    auto it = blocks_.find(id);
-    if (it == blocks_.end() || !it->second.in_use) {
+    std::lock_guard<std::recursive_mutex> lock(shard->mutex);
+
+    uint32_t slot;
+    if (!shard->blocks.find(id, slot) || !shard->blocks.inUse(slot)) {
         return false;  // Invalid ID or block not in use
     }
 
-    MemoryBlock& block = it->second;
-    if (size > block.size) {
+    if (offset > shard->blocks.size(slot) || size > shard->blocks.size(slot) - offset) {
         return false;  // Value too large for block
     }
 
     // Copy value to memory pool
-    memcpy(memory_pool_ + block.offset, value, size);
-
-    dumpMemoryState();
+    writeBlock(*shard, slot, shard->pool + shard->blocks.offset(slot) + offset, value, size);
+    recordChange(ChangeEvent::SET, *shard, slot);
     return true;
 }
 
 bool MemoryManager::get(int id, void* result, size_t size) {
-    std::lock_guard<std::recursive_mutex> lock(memory_mutex_);
+    Shard* shard = shardOf(id);
+    if (!shard) {
+        std::cerr << "[MemoryManager] GET failed for ID " << id << ": Block not found in table." << std::endl;
+        return false;
+    }
+    std::lock_guard<std::recursive_mutex> lock(shard->mutex);
+    BlockTable& blocks = shard->blocks;
 
-    auto it = blocks_.find(id);
-    if (it == blocks_.end()) {
-        std::cerr << "[MemoryManager] GET failed for ID " << id << ": Block not found in map." << std::endl;
+    uint32_t slot;
+    if (!blocks.find(id, slot)) {
+        std::cerr << "[MemoryManager] GET failed for ID " << id << ": Block not found in table." << std::endl;
         return false; // ID no existe
     }
     
-    if (!it->second.in_use) {
+    if (!blocks.inUse(slot)) {
          std::cerr << "[MemoryManager] GET failed for ID " << id << ": Block marked as not in use." << std::endl;
          return false; // Bloque no en uso
     }
 
-    MemoryBlock& block = it->second;
-    if (size > block.size) {
-        std::cerr << "[MemoryManager] GET failed for ID " << id << ": Requested size (" << size << ") > block size (" << block.size << ")." << std::endl;
+    if (size > blocks.size(slot)) {
+        std::cerr << "[MemoryManager] GET failed for ID " << id << ": Requested size (" << size << ") > block size (" << blocks.size(slot) << ")." << std::endl;
         return false;  // Requested size too large
     }
 
     // Copy from memory pool to result buffer
     std::cout << "[MemoryManager] GET successful for ID " << id << ". Copying " << size << " bytes." << std::endl; // Log éxito
-    memcpy(result, memory_pool_ + block.offset, size);
+    memcpy(result, shard->pool + blocks.offset(slot), size);
     return true;
 }
 
-bool MemoryManager::increaseRefCount(int id) {
-    std::lock_guard<std::recursive_mutex> lock(memory_mutex_);
+bool MemoryManager::get(int id, std::vector<char>& result, size_t at) {
+    Shard* shard = shardOf(id);
+    if (!shard) {
+        std::cerr << "[MemoryManager] GET failed for ID " << id << ": Block not found or not in use." << std::endl;
+        return false;
+    }
+    std::lock_guard<std::recursive_mutex> lock(shard->mutex);
 
-    auto it = blocks_.find(id);
-    if (it == blocks_.end() || !it->second.in_use) {
-        return false;  // Invalid ID or block not in use
+    uint32_t slot;
+    if (!shard->blocks.find(id, slot) || !shard->blocks.inUse(slot)) {
+        std::cerr << "[MemoryManager] GET failed for ID " << id << ": Block not found or not in use." << std::endl;
+        return false;
     }
 
-    it->second.ref_count++;
+    size_t size = shard->blocks.size(slot);
+    result.resize(at + size);
+    memcpy(result.data() + at, shard->pool + shard->blocks.offset(slot), size);
     return true;
 }
 
-bool MemoryManager::decreaseRefCount(int id) {
-    std::lock_guard<std::recursive_mutex> lock(memory_mutex_);
+std::vector<std::unique_lock<std::recursive_mutex>> MemoryManager::lockShards() {
+    // Shard mutexes are only ever taken together here, always in index order,
+    // so this cannot deadlock. They are recursive: the methods called while
+    // holding them take them again without waiting.
+    std::vector<std::unique_lock<std::recursive_mutex>> shard_locks;
+    for (auto& shard : shards_) {
+        shard_locks.emplace_back(shard->mutex);
+    }
+    return shard_locks;
+}
 
-    auto it = blocks_.find(id);
-    if (it == blocks_.end() || !it->second.in_use) {
-        return false;  // Invalid ID or block not in use
+void MemoryManager::runBatch(const std::function<void()>& operations) {
+    auto shard_locks = lockShards();
+    operations();
+}
+
+int MemoryManager::chase(int id, size_t next_offset, size_t hops, std::vector<char>& result, size_t at) {
+    // Without a cycle no chain is longer than the number of blocks
+    size_t block_count = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::recursive_mutex> lock(shard->mutex);
+        block_count += shard->blocks.count();
+    }
+    if (hops > block_count) {
+        std::cerr << "[MemoryManager] CHASE refused: " << hops << " hops over " << block_count << " blocks." << std::endl;
+        return -1;
     }
 
-    it->second.ref_count--;
+    // Only the shard of the current hop is locked, so a long walk never stalls
+    // the others. A SET may relink the chain between two hops; each hop then
+    // follows whatever link it reads, and find() rejects an id whose block was
+    // freed and its slot reused meanwhile. Inside runBatch every shard is
+    // already held and the walk sees the chain as it was.
+    for (size_t hop = 0;; hop++) {
+        Shard* shard = shardOf(id);
+        if (!shard) {
+            std::cerr << "[MemoryManager] CHASE failed at hop " << hop << ": block " << id << " not found or not in use." << std::endl;
+            return -1;
+        }
+        std::lock_guard<std::recursive_mutex> lock(shard->mutex);
+        uint32_t slot;
+        if (!shard->blocks.find(id, slot) || !shard->blocks.inUse(slot)) {
+            std::cerr << "[MemoryManager] CHASE failed at hop " << hop << ": block " << id << " not found or not in use." << std::endl;
+            return -1;
+        }
+        const char* block = shard->pool + shard->blocks.offset(slot);
+        size_t size = shard->blocks.size(slot);
+        if (hop == hops) {
+            result.resize(at + size);
+            memcpy(result.data() + at, block, size);
+            return id;
+        }
+        if (next_offset > size || sizeof(int) > size - next_offset) {
+            std::cerr << "[MemoryManager] CHASE failed at hop " << hop << ": offset " << next_offset
+                      << " outside block " << id << " of size " << size << "." << std::endl;
+            return -1;
+        }
+        memcpy(&id, block + next_offset, sizeof(int));
+    }
+}
 
-    // If reference count is 0, mark block as unused (will be cleaned up by GC)
-    if (it->second.ref_count <= 0) {
-        it->second.in_use = false;
+bool MemoryManager::getRange(int id, size_t offset, size_t length, std::vector<char>& result, size_t at) {
+    Shard* shard = shardOf(id);
+    if (!shard) {
+        std::cerr << "[MemoryManager] GET_RANGE failed for ID " << id << ": Block not found or not in use." << std::endl;
+        return false;
     }
+    std::lock_guard<std::recursive_mutex> lock(shard->mutex);
 
-    dumpMemoryState();
+    uint32_t slot;
+    if (!shard->blocks.find(id, slot) || !shard->blocks.inUse(slot)) {
+        std::cerr << "[MemoryManager] GET_RANGE failed for ID " << id << ": Block not found or not in use." << std::endl;
+        return false;
+    }
+    size_t size = shard->blocks.size(slot);
+    if (offset > size || length > size - offset) {
+        std::cerr << "[MemoryManager] GET_RANGE failed for ID " << id << ": Range " << offset << "+" << length
+                  << " outside block of size " << size << "." << std::endl;
+        return false;
+    }
+
+    result.resize(at + length);
+    memcpy(result.data() + at, shard->pool + shard->blocks.offset(slot) + offset, length);
     return true;
 }
 
-void MemoryManager::compactMemory() {
-    std::lock_guard<std::recursive_mutex> lock(memory_mutex_);
-    std::cout << "Starting memory defragmentation..." << std::endl;
+bool MemoryManager::updateInteger(int id, size_t offset, size_t width, uint64_t& previous, const char* operation,
+                                  const std::function<bool(uint64_t current, uint64_t& next)>& update) {
+    if (width != sizeof(uint32_t) && width != sizeof(uint64_t)) {
+        std::cerr << "[MemoryManager] " << operation << " failed for ID " << id << ": Unsupported width " << width << "." << std::endl;
+        return false;
+    }
+    Shard* shard = shardOf(id);
+    if (!shard) {
+        std::cerr << "[MemoryManager] " << operation << " failed for ID " << id << ": Block not found or not in use." << std::endl;
+        return false;
+    }
+    std::lock_guard<std::recursive_mutex> lock(shard->mutex);
 
-    // Verificar si hay bloques que necesitan liberarse
-    bool freeBlocksExist = false;
-    for (const auto& [id, block] : blocks_) {
-        if (!block.in_use) {
-            freeBlocksExist = true;
-            break;
-        }
+    uint32_t slot;
+    if (!shard->blocks.find(id, slot) || !shard->blocks.inUse(slot)) {
+        std::cerr << "[MemoryManager] " << operation << " failed for ID " << id << ": Block not found or not in use." << std::endl;
+        return false;
+    }
+    size_t size = shard->blocks.size(slot);
+    if (offset > size || width > size - offset) {
+        std::cerr << "[MemoryManager] " << operation << " failed for ID " << id << ": Range " << offset << "+" << width
+                  << " outside block of size " << size << "." << std::endl;
+        return false;
     }
 
-    if (!freeBlocksExist) {
-        std::cout << "No free blocks to remove, checking for fragmentation..." << std::endl;
+    // Blocks have no alignment guarantee, so the value is copied in and out
+    char* value = shard->pool + shard->blocks.offset(slot) + offset;
+    if (width == sizeof(uint32_t)) {
+        uint32_t current;
+        memcpy(&current, value, sizeof(current));
+        previous = current;
     } else {
-        std::cout << "Removing free blocks..." << std::endl;
-        // First, remove all blocks with in_use=false
-        for (auto it = blocks_.begin(); it != blocks_.end();) {
-            if (!it->second.in_use) {
-                std::cout << "Removing block with ID: " << it->first << std::endl;
-                it = blocks_.erase(it);
-            } else {
-                ++it;
-            }
+        memcpy(&previous, value, sizeof(previous));
+    }
+
+    uint64_t next;
+    if (update(previous, next)) {
+        if (width == sizeof(uint32_t)) {
+            uint32_t narrow = static_cast<uint32_t>(next);
+            writeBlock(*shard, slot, value, &narrow, sizeof(narrow));
+        } else {
+            writeBlock(*shard, slot, value, &next, sizeof(next));
         }
+        recordChange(ChangeEvent::SET, *shard, slot);
     }
+    return true;
+}
 
-    // Verificar si hay fragmentación
-    bool fragmented = false;
-    size_t last_block_end = 0;
-    
-    // Sort blocks by offset
-    std::vector<std::pair<int, MemoryBlock>> sorted_blocks;
-    for (const auto& [id, block] : blocks_) {
-        sorted_blocks.push_back({id, block});
+bool MemoryManager::compareExchange(int id, size_t offset, size_t width, uint64_t expected, uint64_t desired,
+                                    uint64_t& previous) {
+    if (width == sizeof(uint32_t)) {
+        expected = static_cast<uint32_t>(expected);
     }
+    return updateInteger(id, offset, width, previous, "COMPARE_EXCHANGE", [&](uint64_t current, uint64_t& next) {
+        next = desired;
+        return current == expected;
+    });
+}
 
-    std::sort(sorted_blocks.begin(), sorted_blocks.end(),
-              [](const auto& a, const auto& b) {
-                  return a.second.offset < b.second.offset;
-              });
-    
-    // Verificar si hay espacios entre bloques
-    for (size_t i = 0; i < sorted_blocks.size(); i++) {
-        const auto& [id, block] = sorted_blocks[i];
-        if (block.offset > last_block_end) {
-            std::cout << "Found gap between blocks: " 
-                      << last_block_end << " to " << block.offset 
-                      << " (size: " << block.offset - last_block_end << " bytes)" << std::endl;
-            fragmented = true;
-        }
-        last_block_end = block.offset + block.size;
+bool MemoryManager::fetchAdd(int id, size_t offset, size_t width, uint64_t delta, uint64_t& previous) {
+    return updateInteger(id, offset, width, previous, "FETCH_ADD", [&](uint64_t current, uint64_t& next) {
+        next = current + delta;
+        return true;
+    });
+}
+
+bool MemoryManager::exchange(int id, size_t offset, size_t width, uint64_t value, uint64_t& previous) {
+    return updateInteger(id, offset, width, previous, "EXCHANGE", [&](uint64_t, uint64_t& next) {
+        next = value;
+        return true;
+    });
+}
+
+// Reference counts are updated lock-free (see BlockTable::addRef), so the
+// constant stream of refcount requests never contends for a shard mutex.
+bool MemoryManager::increaseRefCount(int id, uint32_t amount) {
+    Shard* shard = shardOf(id);
+    int count;
+    if (!shard || !shard->blocks.addRef(id, count, amount)) {
+        return false;  // Invalid ID or block already at zero
     }
-    
-    if (!fragmented) {
-        std::cout << "Memory is not fragmented, no compaction needed" << std::endl;
+    // Offset and size need the shard mutex, so the change only carries the count
+    dump_writer_->push({std::chrono::system_clock::now(), ChangeEvent::ADD_REF, id, 0, 0, count, 0});
+    return true;
+}
+
+bool MemoryManager::decreaseRefCount(int id, uint32_t amount) {
+    Shard* shard = shardOf(id);
+    int count;
+    if (!shard || !shard->blocks.dropRef(id, count, amount)) {
+        return false;
+    }
+    // At zero the block is queued for reclaim(); the garbage collector frees it
+    dump_writer_->push({std::chrono::system_clock::now(), ChangeEvent::DROP_REF, id, 0, 0, count, 0});
+    return true;
+}
+
+bool MemoryManager::reclaim(Shard& shard) {
+    std::lock_guard<std::recursive_mutex> lock(shard.mutex);
+    bool freed = false;
+    shard.blocks.takeReclaimed([&](uint32_t slot) {
+        std::cout << "[MemoryManager] Freeing block ID " << shard.blocks.idOf(slot) << " (ref count 0)." << std::endl;
+        releaseBlock(shard, slot);
+        recordChange(ChangeEvent::FREE, shard, slot);
+        freed = true;
+    });
+    return freed;
+}
+
+void MemoryManager::releaseBlock(Shard& shard, uint32_t slot) {
+    if (!shard.blocks.inUse(slot)) {
         return;
     }
+    shard.blocks.flags(slot) &= ~BlockTable::kInUse;
+    shard.allocator->release(shard.blocks.offset(slot), shard.blocks.size(slot), shard.blocks.allocHandle(slot));
+    shard.live_blocks.erase(shard.blocks.offset(slot));
+    shard.released_slots.push_back(slot);
+}
 
-    std::cout << "Compacting memory blocks..." << std::endl;
+void MemoryManager::removeReleasedBlocks(Shard& shard) {
+    for (uint32_t slot : shard.released_slots) {
+        std::cout << "Removing block with ID: " << shard.blocks.idOf(slot) << std::endl;
+        recordChange(ChangeEvent::REMOVE, shard, slot);
+        shard.blocks.remove(slot);
+    }
+    shard.released_slots.clear();
+}
+
+void MemoryManager::recordChange(ChangeEvent::Op op, Shard& shard, uint32_t slot) {
+    BlockTable& blocks = shard.blocks;
+    dump_writer_->push({std::chrono::system_clock::now(), op, blocks.idOf(slot),
+                        static_cast<size_t>(shard.pool - memory_pool_) + blocks.offset(slot),
+                        blocks.size(slot), blocks.refCount(slot), blocks.typeId(slot)});
+}
+
+void MemoryManager::compactMemory(Shard& shard) {
+    std::lock_guard<std::recursive_mutex> lock(shard.mutex);
+
+    // Restart from the bottom of the shard and finish the pass without a budget
+    shard.compact_cursor = 0;
+    compactStep(shard, CompactionBudget{0, std::chrono::microseconds(0)});
+}
+
+bool MemoryManager::compactStep(const CompactionBudget& budget) {
+    bool shard_done = compactStep(*shards_[compact_shard_], budget);
+    if (!shard_done) {
+        return false;
+    }
+    compact_shard_ = (compact_shard_ + 1) % shards_.size();
+    return compact_shard_ == 0;
+}
+
+bool MemoryManager::relocateStep(const CompactionBudget& budget) {
+    bool shard_done = relocateStep(*shards_[compact_shard_], budget);
+    if (!shard_done) {
+        return false;
+    }
+    compact_shard_ = (compact_shard_ + 1) % shards_.size();
+    return compact_shard_ == 0;
+}
+
+bool MemoryManager::compactStep(Shard& shard, const CompactionBudget& budget) {
+    std::lock_guard<std::recursive_mutex> lock(shard.mutex);
+    auto step_start = std::chrono::steady_clock::now();
+    BlockTable& blocks = shard.blocks;
+    Allocator& allocator = *shard.allocator;
+
+    // Remove the metadata of freed blocks; their space is already in the free index
+    removeReleasedBlocks(shard);
+
+    // A single free extent means there is nothing to close up
+    if (!allocator.supportsCompaction() || allocator.freeExtentCount() <= 1) {
+        shard.compact_cursor = 0;
+        return true;
+    }
+
+    if (shard.compact_cursor == 0) {
+        std::cout << "Starting memory defragmentation..." << std::endl;
+    }
+
+    // Slide blocks down into the free extent right below them, in offset order,
+    // starting where the previous step stopped. The gaps accumulate into one
+    // extent at the end of the shard. Each move updates the table before the
+    // next one, so the lock can be released after any of them.
+    size_t moved_bytes = 0;
+    auto it = shard.live_blocks.lower_bound(shard.compact_cursor);
+    while (it != shard.live_blocks.end()) {
+        uint32_t slot = it->second;
+        size_t old_offset = it->first;
+        size_t new_offset = old_offset;
+        size_t size = blocks.size(slot);
+        shard.compact_cursor = old_offset + size;
+
+        // A block being copied by relocateStep keeps its extent until it is published
+        if (!(blocks.flags(slot) & BlockTable::kMoving) &&
+            allocator.slideDown(new_offset, size, blocks.allocHandle(slot))) {
+            std::cout << "Moving block ID " << blocks.idOf(slot)
+                      << " from offset " << old_offset
+                      << " to " << new_offset
+                      << " (size: " << size << " bytes)" << std::endl;
 
-    // Compact blocks
-    size_t current_offset = 0;
-    for (auto& [id, block] : sorted_blocks) {
-        if (block.offset > current_offset) {
-            std::cout << "Moving block ID " << id 
-                      << " from offset " << block.offset 
-                      << " to " << current_offset 
-                      << " (size: " << block.size << " bytes)" << std::endl;
-            
             // Move block data to new offset
-            memmove(memory_pool_ + current_offset,
-                    memory_pool_ + block.offset, block.size);
+            memmove(shard.pool + new_offset, shard.pool + old_offset, size);
+            blocks.offset(slot) = new_offset;
+            it = shard.live_blocks.erase(it);
+            shard.live_blocks.emplace_hint(it, new_offset, slot);
+            recordChange(ChangeEvent::MOVE, shard, slot);
+            moved_bytes += size;
+        } else {
+            ++it;
+        }
 
-            // Update block offset
-            block.offset = current_offset;
-            blocks_[id].offset = current_offset;
+        // Out of budget: let the waiting requests in and resume from the cursor
+        bool bytes_spent = budget.max_bytes != 0 && moved_bytes >= budget.max_bytes;
+        bool time_spent = budget.max_time.count() != 0 &&
+                          std::chrono::steady_clock::now() - step_start >= budget.max_time;
+        if ((bytes_spent || time_spent) && it != shard.live_blocks.end()) {
+            return false;
         }
-        current_offset += block.size;
     }
+    shard.compact_cursor = 0;
 
     // Calcular memoria liberada
-    size_t free_memory = memory_size_ - current_offset;
-    double free_percentage = (static_cast<double>(free_memory) / memory_size_) * 100.0;
+    size_t free_memory = allocator.freeBytes();
+    double free_percentage = (static_cast<double>(free_memory) / shard.size) * 100.0;
     
     std::cout << "Memory defragmentation complete" << std::endl;
-    std::cout << "Total memory: " << memory_size_ << " bytes" << std::endl;
-    std::cout << "Used memory: " << current_offset << " bytes ("
+    std::cout << "Total memory: " << shard.size << " bytes" << std::endl;
+    std::cout << "Used memory: " << shard.size - free_memory << " bytes ("
               << (100.0 - free_percentage) << "%)" << std::endl;
     std::cout << "Free memory: " << free_memory << " bytes ("
               << free_percentage << "%)" << std::endl;
-              
-    dumpMemoryState();
+    return true;
 }
 
-void MemoryManager::dumpMemoryState() {
-    std::cout << "[Dump] Starting dumpMemoryState..." << std::endl; // Log inicio dump
-    auto now = std::chrono::system_clock::now();
-    auto now_time = std::chrono::system_clock::to_time_t(now);
-    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                     now.time_since_epoch()) % 1000;
+bool MemoryManager::relocateStep(Shard& shard, const CompactionBudget& budget) {
+    auto step_start = std::chrono::steady_clock::now();
+    size_t moved_bytes = 0;
+
+    while (true) {
+        PendingMove move;
+        {
+            std::lock_guard<std::recursive_mutex> lock(shard.mutex);
+            removeReleasedBlocks(shard);
+
+            bool found = false;
+            if (shard.allocator->supportsCompaction() && shard.allocator->freeExtentCount() > 1) {
+                auto it = shard.live_blocks.lower_bound(shard.compact_cursor);
+                for (; it != shard.live_blocks.end() && !found; ++it) {
+                    shard.compact_cursor = it->first + shard.blocks.size(it->second);
+                    found = beginMove(shard, it->second, move);
+                }
+            }
+            if (!found) {
+                shard.compact_cursor = 0;
+                return true;
+            }
+        }
 
-    std::stringstream filename;
-    filename << dump_folder_ << "/mem_dump_";
-    filename << std::put_time(std::localtime(&now_time), "%Y%m%d_%H%M%S");
-    filename << "_" << std::setfill('0') << std::setw(3) << now_ms.count() << ".txt";
+        // Copy without the shard mutex. A SET racing with this copy flags the
+        // block kMoveDirty and finishMove throws the copy away.
+        loadRelaxed(shard.pool + move.new_offset, shard.pool + move.old_offset, move.size);
 
-    std::ofstream dump_file(filename.str());
-    if (!dump_file) {
-        std::cerr << "Failed to create memory dump file: " << filename.str() << std::endl;
+        {
+            std::lock_guard<std::recursive_mutex> lock(shard.mutex);
+            if (finishMove(shard, move)) {
+                moved_bytes += move.size;
+            }
+        }
+
+        bool bytes_spent = budget.max_bytes != 0 && moved_bytes >= budget.max_bytes;
+        bool time_spent = budget.max_time.count() != 0 &&
+                          std::chrono::steady_clock::now() - step_start >= budget.max_time;
+        if (bytes_spent || time_spent) {
+            return false;
+        }
+    }
+}
+
+// Reserves a lower extent for a block and flags it kMoving. While its bytes are
+// copied without the shard mutex:
+//  - GET keeps reading the old extent, which stays allocated until finishMove.
+//  - SET writes the old extent and flags the block kMoveDirty, so the copy is
+//    discarded and the block is retried on the next pass.
+//  - If the block is freed, finishMove just releases the destination.
+bool MemoryManager::beginMove(Shard& shard, uint32_t slot, PendingMove& move) {
+    // Pinned blocks (slab slots) stay put; asking for a lower extent would
+    // only carve a slab to hand it straight back
+    if (shard.allocator->pinned(shard.blocks.allocHandle(slot))) {
+        return false;
+    }
+    move.id = shard.blocks.idOf(slot);
+    move.old_offset = shard.blocks.offset(slot);
+    move.size = shard.blocks.size(slot);
+
+    if (!shard.allocator->allocate(move.size, move.new_offset, move.new_handle)) {
+        return false;
+    }
+    if (move.new_offset >= move.old_offset) {
+        shard.allocator->release(move.new_offset, move.size, move.new_handle);
+        return false;
+    }
+
+    shard.blocks.flags(slot) |= BlockTable::kMoving;
+    return true;
+}
+
+// Publishes a copied block at its new offset. Returns false if the move was dropped.
+bool MemoryManager::finishMove(Shard& shard, const PendingMove& move) {
+    BlockTable& blocks = shard.blocks;
+    uint32_t slot;
+    if (!blocks.find(move.id, slot) || !blocks.inUse(slot)) {
+        // Freed while moving: the old extent is already back in the allocator
+        shard.allocator->release(move.new_offset, move.size, move.new_handle);
+        return false;
+    }
+
+    bool dirty = blocks.flags(slot) & BlockTable::kMoveDirty;
+    blocks.flags(slot) &= ~(BlockTable::kMoving | BlockTable::kMoveDirty);
+    if (dirty) {
+        std::cout << "Block ID " << move.id << " was written while moving, will retry" << std::endl;
+        shard.allocator->release(move.new_offset, move.size, move.new_handle);
+        return false;
+    }
+
+    std::cout << "Moving block ID " << move.id << " from offset " << move.old_offset
+              << " to " << move.new_offset << " (size: " << move.size << " bytes)" << std::endl;
+    shard.allocator->release(move.old_offset, move.size, blocks.allocHandle(slot));
+    blocks.offset(slot) = move.new_offset;
+    blocks.allocHandle(slot) = move.new_handle;
+    shard.live_blocks.erase(move.old_offset);
+    shard.live_blocks.emplace(move.new_offset, slot);
+    recordChange(ChangeEvent::MOVE, shard, slot);
+    return true;
+}
+
+void MemoryManager::writeBlock(Shard& shard, uint32_t slot, char* dest, const void* data, size_t size) {
+    if (!(shard.blocks.flags(slot) & BlockTable::kMoving)) {
+        memcpy(dest, data, size);
         return;
     }
+    shard.blocks.flags(slot) |= BlockTable::kMoveDirty;
+    storeRelaxed(dest, static_cast<const char*>(data), size);
+}
 
-    dump_file << "Memory Dump - "
-              << std::put_time(std::localtime(&now_time), "%Y-%m-%d %H:%M:%S")
-              << "." << std::setfill('0') << std::setw(3) << now_ms.count() << "\n\n";
+bool parseDumpMode(const std::string& text, DumpMode& mode) {
+    if (text == "text") {
+        mode = DumpMode::TEXT;
+    } else if (text == "journal") {
+        mode = DumpMode::JOURNAL;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    dump_file << "Total Memory: " << memory_size_ << " bytes\n";
-    dump_file << "Block Count: " << blocks_.size() << "\n\n";
+bool parseCompactionMode(const std::string& text, CompactionMode& mode) {
+    if (text == "sliding") {
+        mode = CompactionMode::SLIDING;
+    } else if (text == "concurrent") {
+        mode = CompactionMode::CONCURRENT;
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    dump_file << "Blocks:\n";
-    dump_file << "-------------------------------------------------------------------------\n";
-    dump_file << "ID\tOffset\tSize\tType\tRef Count\tStatus\n";
-    dump_file << "-------------------------------------------------------------------------\n";
+void MemoryManager::dumpMemoryState() {
+    writeDump({}, 0);
+}
 
-    for (const auto& [id, block] : blocks_) {
-        dump_file << id << "\t"
-                  << block.offset << "\t"
-                  << block.size << "\t"
-                  << block.type << "\t"
-                  << block.ref_count << "\t\t"
-                  << (block.in_use ? "In Use" : "Free") << "\n";
+void MemoryManager::takeSnapshot(DumpSnapshot& snapshot) {
+    snapshot.memory_size = memory_size_;
+    snapshot.allocator = shards_[0]->allocator->name();
+    snapshot.free_extents = 0;
+    snapshot.shards.clear();
+    snapshot.blocks.clear();
+
+    std::lock_guard<std::mutex> dump_lock(dump_mutex_);
+    auto shard_locks = lockShards();
+    snapshot.timestamp = std::chrono::system_clock::now();
+
+    // Offsets are shown from the start of memory_pool_
+    for (auto& shard : shards_) {
+        BlockTable& blocks = shard->blocks;
+        size_t base = shard->pool - memory_pool_;
+        snapshot.shards.push_back({base, shard->size, shard->allocator->freeBytes(), blocks.count()});
+        snapshot.free_extents += shard->allocator->freeExtentCount();
+        blocks.forEach([&](uint32_t slot) {
+            snapshot.blocks.push_back({blocks.idOf(slot), base + blocks.offset(slot), blocks.size(slot),
+                                       blocks.typeId(slot), blocks.refCount(slot), blocks.inUse(slot)});
+        });
     }
+}
 
-    dump_file << "-------------------------------------------------------------------------\n\n";
+void MemoryManager::writeDump(const std::vector<ChangeEvent>& changes, size_t lost) {
+    std::cout << "[Dump] Starting dumpMemoryState..." << std::endl; // Log inicio dump
 
-    dump_file << "Memory Map (showing first 100 bytes or until end):\n";
-    dump_file << "-------------------------------------------------------------------------\n";
+    // Copy the metadata under the locks, format the file without holding any
+    DumpSnapshot snapshot;
+    takeSnapshot(snapshot);
 
-    size_t display_size = std::min(memory_size_, static_cast<size_t>(100));
-    for (size_t i = 0; i < display_size; i++) {
-        bool in_block = false;
-        for (const auto& [id, block] : blocks_) {
-            if (block.in_use && block.offset <= i && i < block.offset + block.size) {
-                dump_file << "[" << id << "]";
-                in_block = true;
-                break;
-            }
+    std::string filename = dumpFileName(dump_folder_, snapshot.timestamp);
+    std::ofstream dump_file(filename);
+    if (!dump_file) {
+        std::cerr << "Failed to create memory dump file: " << filename << std::endl;
+        return;
+    }
+    writeDumpText(dump_file, snapshot, changes, lost, types_);
+
+    dump_file.close();
+    std::cout << "[Dump] Memory dump created: " << filename << std::endl;
+    std::cout << "[Dump] Finished dumpMemoryState." << std::endl; // Log fin dump
+}
+
+void MemoryManager::writeJournal(const std::vector<ChangeEvent>& changes, size_t lost) {
+    size_t next = 0;
+    do {
+        // Every file starts with the whole state so it can be replayed without
+        // the ones before it (which rotation may have deleted). Lost changes
+        // can't be replayed either, so they are covered the same way.
+        DumpSnapshot snapshot;
+        bool checkpoint = journal_->atFileStart() || lost != 0;
+        if (checkpoint) {
+            takeSnapshot(snapshot);
         }
 
-        if (!in_block) {
-            dump_file << "[ ]";
+        // Keep the checkpoint and the batch in one file, so a file never starts
+        // halfway through either. Rotating first means the new file's first
+        // record is the checkpoint.
+        size_t checkpoint_records = checkpoint ? snapshot.blocks.size() + 1 : 0;
+        if (!journal_->hasRoom(checkpoint_records + changes.size() - next) && !journal_->atFileStart()) {
+            journal_->rotate();
+            if (!checkpoint) {
+                takeSnapshot(snapshot);
+                checkpoint = true;
+            }
         }
 
-        if ((i + 1) % 10 == 0) {
-            dump_file << "\n";
+        if (checkpoint) {
+            // Stamped with the first change still to write: those changes are
+            // replayed after the checkpoint, and every record carries absolute
+            // values, so replaying a change the snapshot already has is harmless
+            auto stamp = next < changes.size() ? changes[next].timestamp : snapshot.timestamp;
+            JournalRecord record{};
+            record.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                      stamp.time_since_epoch()).count();
+            record.op = JournalRecord::CHECKPOINT;
+            record.id = -1;
+            journal_->append(record);
+
+            record.op = JournalRecord::BLOCK;
+            for (const DumpSnapshot::Block& block : snapshot.blocks) {
+                record.flags = block.in_use ? JournalRecord::kInUse : 0;
+                record.id = block.id;
+                record.offset = block.offset;
+                record.size = block.size;
+                record.ref_count = block.ref_count;
+                record.type_id = block.type_id;
+                journal_->append(record);
+            }
         }
-    }
 
-    dump_file.close();
-    std::cout << "[Dump] Memory dump created: " << filename.str() << std::endl;
-    std::cout << "[Dump] Finished dumpMemoryState." << std::endl; // Log fin dump
+        // A batch bigger than what is left of a fresh file goes on in the next
+        // one, after that file's own checkpoint. The Journal constructor made
+        // sure a file always has room for a checkpoint and one change.
+        size_t end = next + std::min(changes.size() - next, journal_->room());
+        for (; next < end; next++) {
+            journal_->append(JournalRecord::fromChange(changes[next]));
+        }
+        lost = 0;
+    } while (next < changes.size());
+    journal_->flush();
 }
 
 void MemoryManager::startGarbageCollector() {
@@ -5,52 +5,169 @@
 #ifndef MEMORY_MANAGER_H
 #define MEMORY_MANAGER_H
 
-#endif //MEMORY_MANAGER_H
-
 #include<iostream>
-#include<unordered_map>
 #include<mutex>
 #include<thread>
 #include<string>
 #include <vector>
+#include <memory>
+#include <map>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include "allocator.h"
+#include "block_table.h"
+#include "type_registry.h"
+#include "dump_writer.h"
+#include "journal.h"
 
 class GarbageCollector; // Declaración adelantada
-class SocketServer;     // Declaración adelantada
+
+// Limits of a single incremental compaction step. A step stops after the first
+// move that reaches either limit; 0 disables that limit.
+struct CompactionBudget {
+    size_t max_bytes = 256 * 1024;
+    std::chrono::microseconds max_time{2000};
+};
+
+// How the garbage collector defragments the pool
+enum class CompactionMode {
+    SLIDING,    // Slide blocks down in place, holding the memory mutex during each step
+    CONCURRENT  // Copy blocks to a lower free extent without holding the memory mutex
+};
+
+bool parseCompactionMode(const std::string& text, CompactionMode& mode);
+
+// How changes to the memory are recorded in DUMP_FOLDER
+enum class DumpMode {
+    TEXT,       // A readable dump file per burst of changes
+    JOURNAL     // Binary records in a rotating journal, turned into dumps offline
+};
+
+bool parseDumpMode(const std::string& text, DumpMode& mode);
 
 class MemoryManager {
 public:
-    MemoryManager(size_t size_mb, const std::string& dump_folder);
+    static constexpr size_t kMaxShards = 64;
+
+    MemoryManager(size_t size_mb, const std::string& dump_folder,
+                  AllocationPolicy policy = AllocationPolicy::FREE_LIST,
+                  size_t slab_threshold = kDefaultSlabThreshold,
+                  size_t shard_count = 1,
+                  DumpMode dump_mode = DumpMode::TEXT);
     ~MemoryManager();
 
-    int create(size_t size, const std::string& type);
-    bool set(int id, const void* value, size_t size);
+    // The block starts with weight references; see increaseRefCount
+    int create(size_t size, uint32_t type_id, uint32_t weight = 1);
+    bool registerType(uint32_t type_id, const std::string& name);
+    bool set(int id, const void* value, size_t size, size_t offset = 0);   // Writes block bytes [offset, offset + size)
     bool get(int id, void* result, size_t size);
-    bool increaseRefCount(int id);
-    bool decreaseRefCount(int id);
+    bool get(int id, std::vector<char>& result, size_t at = 0);    // Copies the whole block to result[at..], resizing it
+    bool getRange(int id, size_t offset, size_t length, std::vector<char>& result, size_t at = 0);  // Same, block bytes [offset, offset + length)
+    // A block's count is the total weight handed out to its holders. A client
+    // may split its share among copies without telling the server, so only
+    // adding weight and returning it (amount at a time) reach these calls.
+    bool increaseRefCount(int id, uint32_t amount = 1);
+    bool decreaseRefCount(int id, uint32_t amount = 1);
+
+    // Read-modify-write of the 4- or 8-byte integer (width) at block bytes
+    // [offset, offset + width), under the shard mutex like set(), so no other
+    // request sees it halfway. previous receives the value found; values wrap
+    // around at width bytes.
+    bool compareExchange(int id, size_t offset, size_t width, uint64_t expected, uint64_t desired, uint64_t& previous);
+    bool fetchAdd(int id, size_t offset, size_t width, uint64_t delta, uint64_t& previous);
+    bool exchange(int id, size_t offset, size_t width, uint64_t value, uint64_t& previous);
+
+    // Runs operations (calls to the methods above) with every shard locked, so
+    // no other request reads or writes a block halfway through them. Reference
+    // counts stay lock-free and may still change meanwhile.
+    void runBatch(const std::function<void()>& operations);
+
+    // Follows a chain of blocks: each one holds the id of the next at
+    // next_offset. Copies the block reached after hops steps to result[at..],
+    // like get(), and returns its id; -1 if the chain ends or breaks first.
+    int chase(int id, size_t next_offset, size_t hops, std::vector<char>& result, size_t at = 0);
 
     void startGarbageCollector();
-    void dumpMemoryState();
+    void dumpMemoryState();         // Writes a dump right away, without waiting for the dump writer
 
-    // Hacemos amigos a GarbageCollector y SocketServer para que puedan acceder a métodos/atributos privados
+    // Hacemos amigo a GarbageCollector para que pueda acceder a métodos/atributos privados
     friend class GarbageCollector;
-    friend class SocketServer;
+    friend struct MemoryManagerTest;    // tests/memory_manager_test.cpp drives compaction step by step
 
 private:
+    // An independent arena of memory_pool_ with its own metadata, allocator and
+    // lock. Requests on blocks of different shards never wait for each other.
+    // Offsets stored in a shard are relative to its base.
+    struct Shard {
+        Shard(char* pool, size_t size, uint32_t index_base, uint32_t max_slots,
+              std::unique_ptr<Allocator> allocator);
+
+        char* pool;                 // memory_pool_ + base of this shard
+        size_t size;
+        BlockTable blocks;          // Metadata of the shard's blocks
+        std::unique_ptr<Allocator> allocator;  // Tracks the free extents of the shard
+        std::recursive_mutex mutex;
+
+        // Live blocks by offset, so a compaction step can resume where the last one stopped
+        std::map<size_t, uint32_t> live_blocks;
+        std::vector<uint32_t> released_slots;  // Freed blocks whose metadata is still in blocks
+        size_t compact_cursor = 0;             // Blocks below this offset are already compacted
+    };
+
     char* memory_pool_;             // Single memory allocation
     size_t memory_size_;
     std::string dump_folder_;
 
-    struct MemoryBlock {
-        size_t offset;
+    TypeRegistry types_;            // Names of the type ids stored in the block tables
+    std::vector<std::unique_ptr<Shard>> shards_;
+    int shard_slot_bits_;           // Low bits of an id's slot index; the bits above pick the shard
+    std::atomic<size_t> next_shard_{0};    // Round-robin cursor for create()
+    size_t compact_shard_ = 0;      // Shard the garbage collector is compacting
+    std::mutex dump_mutex_;         // Taken before any shard mutex
+    std::unique_ptr<Journal> journal_;          // Only in DumpMode::JOURNAL
+    std::unique_ptr<DumpWriter> dump_writer_;   // Writes the dumps of recorded changes
+    std::thread gc_thread_;
+
+    Shard* shardOf(int id);
+    std::vector<std::unique_lock<std::recursive_mutex>> lockShards();   // Every shard, in index order
+    int createIn(Shard& shard, size_t size, uint32_t type_id, uint32_t weight);
+
+    // Shared by the atomic operations: update gets the current value and
+    // returns whether to store the one it leaves in next
+    bool updateInteger(int id, size_t offset, size_t width, uint64_t& previous, const char* operation,
+                       const std::function<bool(uint64_t current, uint64_t& next)>& update);
+
+    void releaseBlock(Shard& shard, uint32_t slot);  // Marks a block free and returns its extent
+    bool reclaim(Shard& shard);     // Frees the blocks whose count reached zero; true if any
+    void compactMemory(Shard& shard);   // Memory defragmentation of one shard, in one go
+
+    // One bounded compaction step over the shards in turn; true when a pass over
+    // every shard is done. Both take each shard's mutex themselves.
+    bool compactStep(const CompactionBudget& budget);
+    bool relocateStep(const CompactionBudget& budget);  // Same, but copies outside the shard mutex
+    bool compactStep(Shard& shard, const CompactionBudget& budget);
+    bool relocateStep(Shard& shard, const CompactionBudget& budget);
+
+    // A block being copied to a lower extent by relocateStep
+    struct PendingMove {
+        int id;
+        size_t old_offset;
+        size_t new_offset;
         size_t size;
-        std::string type;
-        int ref_count;
-        bool in_use;
+        uint32_t new_handle;
     };
+    bool beginMove(Shard& shard, uint32_t slot, PendingMove& move);
+    bool finishMove(Shard& shard, const PendingMove& move);
+    // Every write to a block's bytes goes through here (with the shard mutex)
+    void writeBlock(Shard& shard, uint32_t slot, char* dest, const void* data, size_t size);
+    void removeReleasedBlocks(Shard& shard);
 
-    std::unordered_map<int, MemoryBlock> blocks_;
-    std::recursive_mutex memory_mutex_;
-    std::thread gc_thread_;
-
-    void compactMemory();           // Memory defragmentation
+    // Queues a change to a block for the dump writer; needs the shard's mutex
+    void recordChange(ChangeEvent::Op op, Shard& shard, uint32_t slot);
+    void takeSnapshot(DumpSnapshot& snapshot);  // Takes dump_mutex_ and every shard mutex
+    void writeDump(const std::vector<ChangeEvent>& changes, size_t lost);
+    void writeJournal(const std::vector<ChangeEvent>& changes, size_t lost);
 };
+
+#endif //MEMORY_MANAGER_H
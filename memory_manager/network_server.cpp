@@ -0,0 +1,51 @@
+// network_server.cpp
+#include "network_server.h"
+#include "socket_server.h"
+#ifdef __linux__
+#include "epoll_server.h"
+#endif
+#include "uring_server.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+std::unique_ptr<NetworkServer> makeNetworkServer(NetworkBackend backend, int port,
+                                                 MemoryManager* memory_manager, size_t workers) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    switch (backend) {
+#ifdef HAVE_IO_URING
+        case NetworkBackend::IO_URING:
+            if (UringServer::isSupported()) {
+                return std::make_unique<UringServer>(port, memory_manager, workers);
+            }
+            std::cerr << "io_uring is not available on this kernel, using epoll instead" << std::endl;
+            return std::make_unique<EpollServer>(port, memory_manager, workers);
+#endif
+#ifdef __linux__
+        case NetworkBackend::EPOLL:
+            return std::make_unique<EpollServer>(port, memory_manager, workers);
+#endif
+        case NetworkBackend::THREADS:
+        default:
+            return std::make_unique<SocketServer>(port, memory_manager);
+    }
+}
+
+bool parseNetworkBackend(const std::string& text, NetworkBackend& backend) {
+    if (text == "threads") {
+        backend = NetworkBackend::THREADS;
+#ifdef __linux__
+    } else if (text == "epoll") {
+        backend = NetworkBackend::EPOLL;
+#endif
+#ifdef HAVE_IO_URING
+    } else if (text == "io_uring") {
+        backend = NetworkBackend::IO_URING;
+#endif
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef NETWORK_SERVER_H
+#define NETWORK_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class MemoryManager;
+
+// How the memory manager serves its clients
+enum class NetworkBackend {
+    THREADS,    // One blocking thread per client (SocketServer)
+    EPOLL,      // Non-blocking sockets on one epoll loop plus a fixed worker pool (Linux only)
+    IO_URING    // Batched submissions on an io_uring plus a fixed worker pool (Linux 6.0+)
+};
+
+// What a server did so far, to compare backends
+struct NetworkStats {
+    uint64_t requests = 0;
+    uint64_t syscalls = 0;  // Socket and event system calls spent serving them
+};
+
+// A server that reads length-prefixed Messages from its clients and answers
+// each one through a RequestHandler
+class NetworkServer {
+public:
+    virtual ~NetworkServer() = default;
+
+    virtual void start() = 0;   // Throws std::runtime_error if the port can't be opened
+    virtual void stop() = 0;
+    virtual NetworkStats stats() const = 0;
+};
+
+// 0 workers means one per hardware thread. IO_URING falls back to EPOLL when
+// the kernel doesn't support (or allow) it.
+std::unique_ptr<NetworkServer> makeNetworkServer(NetworkBackend backend, int port,
+                                                 MemoryManager* memory_manager, size_t workers = 0);
+
+// Fails for unknown names and for backends this platform doesn't have
+bool parseNetworkBackend(const std::string& text, NetworkBackend& backend);
+
+#endif //NETWORK_SERVER_H
@@ -0,0 +1,272 @@
+// request_handler.cpp
+#include "request_handler.h"
+#include "memory_manager.h"
+#include "../protocol/frame_io.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// How many references an INCREASE/DECREASE_REF_COUNT adds or drops; the size
+// field carries it and 0 (what older clients send) means one
+uint32_t refCountAmount(const MessageView& request) {
+    size_t amount = request.getSize();
+    return amount == 0 ? 1 : static_cast<uint32_t>(std::min<size_t>(amount, INT32_MAX));
+}
+
+}
+
+void RequestHandler::process(const MessageView& request, std::vector<char>& out) {
+    if (request.getType() == MessageType::BATCH) {
+        processBatch(request, out);
+        return;
+    }
+    processOne(request, out, nullptr);
+}
+
+void RequestHandler::processBatch(const MessageView& request, std::vector<char>& out) {
+    WireFormat format = request.getFormat();
+    uint32_t request_id = request.getRequestId();
+
+    // Decode every operation before running any, so a malformed batch changes nothing
+    std::vector<MessageView> operations;
+    try {
+        for (std::span<const char> frame : MessageView::splitBatch(request.getData())) {
+            operations.push_back(MessageView::decode(frame));
+            if (operations.back().getType() == MessageType::BATCH) {
+                throw std::runtime_error("nested batch");
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[RequestHandler] Malformed batch: " << e.what() << std::endl;
+        Message::appendResponse(out, format, request_id, false);
+        return;
+    }
+
+    // One framed sub-response per operation, written in place after the header
+    size_t header_end = Message::appendResponseHeader(out, format, request_id, true);
+    std::vector<int> block_ids;     // Block of each operation, for batchRef
+    block_ids.reserve(operations.size());
+    auto run = [&]() {
+        for (const MessageView& operation : operations) {
+            size_t frame_start = beginFrame(out);
+            block_ids.push_back(processOne(operation, out, &block_ids));
+            endFrame(out, frame_start);
+        }
+    };
+
+    // Reference counts are lock-free, so a batch of nothing else (what clients
+    // send when they flush coalesced count changes) needs no shard mutex
+    bool counts_only = std::all_of(operations.begin(), operations.end(), [](const MessageView& operation) {
+        return operation.getType() == MessageType::INCREASE_REF_COUNT ||
+               operation.getType() == MessageType::DECREASE_REF_COUNT;
+    });
+    if (counts_only) {
+        run();
+    } else {
+        memory_manager_->runBatch(run);
+    }
+    Message::finishResponse(out, format, header_end);
+}
+
+int RequestHandler::processOne(const MessageView& request, std::vector<char>& out, const std::vector<int>* batch) {
+    WireFormat format = request.getFormat();
+    uint32_t request_id = request.getRequestId();     // Echoed so a pipelining client can match the response
+
+    // Inside a batch, batchRef(k) stands for the block of operation k
+    auto resolve = [batch](int id) {
+        if (!batch || id > -2) {
+            return id;
+        }
+        size_t index = static_cast<size_t>(-2 - id);
+        return index < batch->size() ? (*batch)[index] : -1;
+    };
+
+    switch (request.getType()) {
+        case MessageType::CREATE: {
+            size_t size = request.getSize();
+            uint32_t typeId = request.getTypeId();
+            std::span<const char> data = request.getData();
+
+            // The initial weight, if the client asks for more than one reference
+            uint32_t weight = 1;
+            if (data.size() == sizeof(uint32_t)) {
+                std::memcpy(&weight, data.data(), sizeof(uint32_t));
+            }
+            int id = memory_manager_->create(size, typeId, weight);
+
+            // Respond with the ID
+            Message::appendResponse(out, format, request_id, id != -1, std::span<const char>(reinterpret_cast<const char*>(&id), sizeof(int)));
+            return id;
+        }
+
+        case MessageType::REGISTER_TYPE: {
+            bool success = memory_manager_->registerType(request.getTypeId(), std::string(request.getDataType()));
+            Message::appendResponse(out, format, request_id, success);
+            return -1;
+        }
+
+        case MessageType::SET: {
+            int id = resolve(request.getId());
+            std::span<const char> data = request.getData();
+
+            bool success = memory_manager_->set(id, data.data(), data.size());
+
+            Message::appendResponse(out, format, request_id, success);
+            return success ? id : -1;
+        }
+
+        case MessageType::SET_RANGE: {
+            int id = resolve(request.getId());
+            std::span<const char> data = request.getData();
+
+            bool success = memory_manager_->set(id, data.data(), data.size(), request.getSize());
+
+            Message::appendResponse(out, format, request_id, success);
+            return success ? id : -1;
+        }
+
+        case MessageType::GET_RANGE: {
+            int id = resolve(request.getId());
+            std::span<const char> data = request.getData();
+
+            size_t start = out.size();
+            size_t header_end = Message::appendResponseHeader(out, format, request_id, true);
+            uint32_t length;
+            if (data.size() == sizeof(uint32_t)) {
+                std::memcpy(&length, data.data(), sizeof(uint32_t));
+                if (memory_manager_->getRange(id, request.getSize(), length, out, header_end)) {
+                    Message::finishResponse(out, format, header_end);
+                    return id;
+                }
+            }
+            out.resize(start);
+            Message::appendResponse(out, format, request_id, false);
+            return -1;
+        }
+
+        case MessageType::LINK: {
+            int id = resolve(request.getId());
+            std::span<const char> data = request.getData();
+            bool success = data.size() == sizeof(int);
+            if (success) {
+                int target;
+                std::memcpy(&target, data.data(), sizeof(int));
+                int resolved = resolve(target);
+                // -1 clears the link; a reference must name a block that exists
+                success = (target >= -1 || resolved >= 0) &&
+                          memory_manager_->set(id, &resolved, sizeof(int), request.getSize());
+            }
+            Message::appendResponse(out, format, request_id, success);
+            return success ? id : -1;
+        }
+
+        case MessageType::GET: {
+            int id = resolve(request.getId());
+
+            // get() lee el tamaño y los datos del bloque bajo un mismo lock,
+            // y los copia ya en su sitio dentro de la respuesta
+            size_t start = out.size();
+            size_t header_end = Message::appendResponseHeader(out, format, request_id, true);
+            if (memory_manager_->get(id, out, header_end)) {
+                Message::finishResponse(out, format, header_end);
+                return id;
+            }
+            std::cerr << "[RequestHandler] GET failed for ID " << id << ": Block not found or not in use." << std::endl;
+            out.resize(start);
+            Message::appendResponse(out, format, request_id, false);
+            return -1;
+        }
+
+        case MessageType::CHASE: {
+            int id = resolve(request.getId());
+            std::span<const char> data = request.getData();
+
+            // The id of the block reached goes first, then its bytes, copied in place
+            size_t start = out.size();
+            size_t header_end = Message::appendResponseHeader(out, format, request_id, true);
+            int last_id = -1;
+            if (data.size() == sizeof(uint32_t)) {
+                uint32_t hops;
+                std::memcpy(&hops, data.data(), sizeof(uint32_t));
+                last_id = memory_manager_->chase(id, request.getSize(), hops, out, header_end + sizeof(int));
+            }
+            if (last_id >= 0) {
+                std::memcpy(out.data() + header_end, &last_id, sizeof(int));
+                Message::finishResponse(out, format, header_end);
+                return last_id;
+            }
+            out.resize(start);
+            Message::appendResponse(out, format, request_id, false);
+            return -1;
+        }
+
+        case MessageType::ATOMIC: {
+            int id = resolve(request.getId());
+            std::span<const char> data = request.getData();
+
+            // op, then the operand and, for COMPARE_EXCHANGE, the expected value
+            bool success = !data.empty();
+            size_t width = 0;
+            uint64_t value = 0;
+            uint64_t expected = 0;
+            uint64_t previous = 0;
+            if (success) {
+                AtomicOp op = static_cast<AtomicOp>(data[0]);
+                size_t operands = op == AtomicOp::COMPARE_EXCHANGE ? 2 : 1;
+                width = (data.size() - 1) / operands;
+                success = width <= sizeof(uint64_t) && data.size() == 1 + width * operands;
+                if (success) {
+                    std::memcpy(&value, data.data() + 1, width);
+                    if (operands == 2) {
+                        std::memcpy(&expected, data.data() + 1 + width, width);
+                    }
+                }
+                if (success) {
+                    switch (op) {
+                        case AtomicOp::COMPARE_EXCHANGE:
+                            success = memory_manager_->compareExchange(id, request.getSize(), width, expected, value, previous);
+                            break;
+                        case AtomicOp::FETCH_ADD:
+                            success = memory_manager_->fetchAdd(id, request.getSize(), width, value, previous);
+                            break;
+                        case AtomicOp::EXCHANGE:
+                            success = memory_manager_->exchange(id, request.getSize(), width, value, previous);
+                            break;
+                        default:
+                            success = false;
+                    }
+                }
+            }
+
+            // The previous value, in the width it was asked with
+            if (success) {
+                Message::appendResponse(out, format, request_id, true,
+                                        std::span<const char>(reinterpret_cast<const char*>(&previous), width));
+            } else {
+                Message::appendResponse(out, format, request_id, false);
+            }
+            return success ? id : -1;
+        }
+
+        case MessageType::INCREASE_REF_COUNT: {
+            int id = resolve(request.getId());
+            bool success = memory_manager_->increaseRefCount(id, refCountAmount(request));
+            Message::appendResponse(out, format, request_id, success);
+            return success ? id : -1;
+        }
+
+        case MessageType::DECREASE_REF_COUNT: {
+            int id = resolve(request.getId());
+            bool success = memory_manager_->decreaseRefCount(id, refCountAmount(request));
+            Message::appendResponse(out, format, request_id, success);
+            return success ? id : -1;
+        }
+
+        default:
+            Message::appendResponse(out, format, request_id, false);
+            return -1;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef REQUEST_HANDLER_H
+#define REQUEST_HANDLER_H
+
+#include <vector>
+#include "../protocol/message.h"
+
+class MemoryManager;
+
+// Turns a decoded request into the MemoryManager call it asks for and builds
+// the response. Shared by every network backend; safe to call from any number
+// of threads at once.
+class RequestHandler {
+public:
+    explicit RequestHandler(MemoryManager* memory_manager) : memory_manager_(memory_manager) {}
+
+    // Appends the response to out, in the format the request came in. Reads
+    // SET data straight from the request's buffer and copies GET data straight
+    // into out, so a connection that reuses out allocates nothing per request.
+    void process(const MessageView& request, std::vector<char>& out);
+
+private:
+    // Runs a BATCH's operations under MemoryManager::runBatch
+    void processBatch(const MessageView& request, std::vector<char>& out);
+    // Returns the block the operation acted on (or created), -1 if it failed.
+    // batch holds those of the earlier operations of the batch, if any.
+    int processOne(const MessageView& request, std::vector<char>& out, const std::vector<int>* batch);
+
+    MemoryManager* memory_manager_;
+};
+
+#endif //REQUEST_HANDLER_H
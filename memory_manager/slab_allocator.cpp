@@ -0,0 +1,158 @@
+// slab_allocator.cpp
+#include "slab_allocator.h"
+#include <bit>
+#include <iostream>
+
+SlabAllocator::SlabAllocator(std::unique_ptr<Allocator> backing, size_t threshold)
+    : backing_(std::move(backing)), threshold_(threshold) {
+    name_ = std::string(backing_->name()) + "+slab";
+
+    if (threshold == 0) {
+        return;
+    }
+
+    // 4, 8, 12, 16, then two classes per power of two (24, 32, 48, 64, 96, ...)
+    for (size_t size = 4; size <= 16 && size - 4 < threshold; size += 4) {
+        classes_.push_back({size, kNone, kNone});
+    }
+    for (size_t base = 16; classes_.back().object_size < threshold; base *= 2) {
+        classes_.push_back({base + base / 2, kNone, kNone});
+        if (classes_.back().object_size < threshold) {
+            classes_.push_back({base * 2, kNone, kNone});
+        }
+    }
+}
+
+bool SlabAllocator::allocate(size_t size, size_t& offset, uint32_t& handle) {
+    int c = sizeClassFor(size);
+    if (c < 0) {
+        return backing_->allocate(size, offset, handle);
+    }
+
+    SizeClass& size_class = classes_[c];
+    uint32_t s = size_class.partial_head;
+    if (s == kNone) {
+        s = newSlab(static_cast<uint32_t>(c));
+        if (s == kNone) {
+            return false;
+        }
+    }
+
+    Slab& slab = slabs_[s];
+    int slot = std::countr_one(slab.occupancy);
+    slab.occupancy |= uint64_t(1) << slot;
+    if (size_class.empty_slab == s) {
+        size_class.empty_slab = kNone;
+    }
+    if (slab.occupancy == ~uint64_t(0)) {
+        removePartial(s);
+    }
+
+    offset = slab.offset + static_cast<size_t>(slot) * size_class.object_size;
+    handle = kSlabHandle | s;
+    return true;
+}
+
+void SlabAllocator::release(size_t offset, size_t size, uint32_t handle) {
+    if (!(handle & kSlabHandle)) {
+        backing_->release(offset, size, handle);
+        return;
+    }
+
+    uint32_t s = handle & ~kSlabHandle;
+    if (s >= slabs_.size() || offset < slabs_[s].offset) {
+        std::cerr << "[Slab] Ignoring release of unknown slot at offset " << offset << std::endl;
+        return;
+    }
+
+    Slab& slab = slabs_[s];
+    SizeClass& size_class = classes_[slab.size_class];
+    size_t slot = (offset - slab.offset) / size_class.object_size;
+    uint64_t bit = uint64_t(1) << slot;
+    if (slot >= kSlotsPerSlab || !(slab.occupancy & bit)) {
+        std::cerr << "[Slab] Ignoring release of free slot at offset " << offset << std::endl;
+        return;
+    }
+
+    bool was_full = slab.occupancy == ~uint64_t(0);
+    slab.occupancy &= ~bit;
+    if (was_full) {
+        pushPartial(s);
+    }
+
+    if (slab.occupancy == 0) {
+        if (size_class.empty_slab == kNone) {
+            size_class.empty_slab = s;
+        } else {
+            // Already holding a spare slab for this class: give this one back
+            removePartial(s);
+            backing_->release(slab.offset, size_class.object_size * kSlotsPerSlab, slab.backing_handle);
+            unused_slabs_.push_back(s);
+        }
+    }
+}
+
+bool SlabAllocator::slideDown(size_t& offset, size_t size, uint32_t handle) {
+    if (pinned(handle)) {
+        return false;
+    }
+    return backing_->slideDown(offset, size, handle);
+}
+
+int SlabAllocator::sizeClassFor(size_t size) const {
+    if (size == 0 || size > threshold_) {
+        return -1;
+    }
+    int c = 0;
+    while (classes_[c].object_size < size) {
+        c++;
+    }
+    return c;
+}
+
+uint32_t SlabAllocator::newSlab(uint32_t size_class) {
+    size_t slab_bytes = classes_[size_class].object_size * kSlotsPerSlab;
+    size_t offset = 0;
+    uint32_t backing_handle = 0;
+    if (!backing_->allocate(slab_bytes, offset, backing_handle)) {
+        return kNone;
+    }
+
+    uint32_t s;
+    if (!unused_slabs_.empty()) {
+        s = unused_slabs_.back();
+        unused_slabs_.pop_back();
+    } else {
+        s = static_cast<uint32_t>(slabs_.size());
+        slabs_.push_back({});
+    }
+    slabs_[s] = {offset, backing_handle, 0, size_class, kNone, kNone};
+    pushPartial(s);
+    return s;
+}
+
+void SlabAllocator::pushPartial(uint32_t s) {
+    SizeClass& size_class = classes_[slabs_[s].size_class];
+    slabs_[s].prev_partial = kNone;
+    slabs_[s].next_partial = size_class.partial_head;
+    if (size_class.partial_head != kNone) {
+        slabs_[size_class.partial_head].prev_partial = s;
+    }
+    size_class.partial_head = s;
+}
+
+void SlabAllocator::removePartial(uint32_t s) {
+    SizeClass& size_class = classes_[slabs_[s].size_class];
+    uint32_t prev = slabs_[s].prev_partial;
+    uint32_t next = slabs_[s].next_partial;
+    if (prev != kNone) {
+        slabs_[prev].next_partial = next;
+    } else {
+        size_class.partial_head = next;
+    }
+    if (next != kNone) {
+        slabs_[next].prev_partial = prev;
+    }
+    slabs_[s].prev_partial = kNone;
+    slabs_[s].next_partial = kNone;
+}
@@ -0,0 +1,71 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include "allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Slab layer for small blocks.
+// Requests up to 'threshold' bytes are rounded to a size class and served from
+// slabs: runs of 64 equal slots carved out of the pool by the backing allocator,
+// each with a 64-bit occupancy bitmap. Anything larger goes straight to the
+// backing allocator.
+//
+// Slabs are never moved by compaction, so small blocks stay out of the way of
+// the large extents that compactMemory has to slide around.
+class SlabAllocator : public Allocator {
+public:
+    SlabAllocator(std::unique_ptr<Allocator> backing, size_t threshold);
+
+    bool allocate(size_t size, size_t& offset, uint32_t& handle) override;
+    void release(size_t offset, size_t size, uint32_t handle) override;
+    bool slideDown(size_t& offset, size_t size, uint32_t handle) override;
+    bool supportsCompaction() const override { return backing_->supportsCompaction(); }
+    bool pinned(uint32_t handle) const override { return (handle & kSlabHandle) != 0; }
+
+    // Free space is reported for the backing allocator: free slab slots can only
+    // hold small blocks.
+    size_t freeBytes() const override { return backing_->freeBytes(); }
+    size_t freeExtentCount() const override { return backing_->freeExtentCount(); }
+    size_t largestFreeExtent() const override { return backing_->largestFreeExtent(); }
+    const char* name() const override { return name_.c_str(); }
+
+    size_t slabCount() const { return slabs_.size() - unused_slabs_.size(); }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    static constexpr uint32_t kSlabHandle = 1u << 31;  // Marks handles owned by this layer
+    static constexpr int kSlotsPerSlab = 64;
+
+    struct Slab {
+        size_t offset;
+        uint32_t backing_handle;
+        uint64_t occupancy;         // Bit i set = slot i in use
+        uint32_t size_class;
+        uint32_t prev_partial;
+        uint32_t next_partial;
+    };
+
+    struct SizeClass {
+        size_t object_size;
+        uint32_t partial_head;      // Slabs with at least one free slot
+        uint32_t empty_slab;        // One fully free slab kept to avoid churn
+    };
+
+    int sizeClassFor(size_t size) const;
+    uint32_t newSlab(uint32_t size_class);
+    void pushPartial(uint32_t s);
+    void removePartial(uint32_t s);
+
+    std::unique_ptr<Allocator> backing_;
+    size_t threshold_;
+    std::string name_;
+    std::vector<SizeClass> classes_;
+    std::vector<Slab> slabs_;
+    std::vector<uint32_t> unused_slabs_;
+};
+
+#endif //SLAB_ALLOCATOR_H
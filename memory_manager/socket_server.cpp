@@ -6,27 +6,66 @@
 #include "socket_server.h"
 #include "memory_manager.h"
 #include "../protocol/message.h"
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "../protocol/frame_io.h"
 #include <iostream>
 #include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
 
 #pragma comment(lib, "ws2_32.lib")
+#else
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Just enough of the Winsock names for the code below to read the same on both platforms
+constexpr FrameSocket INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+#endif
+
+namespace {
+
+std::string lastSocketError() {
+#ifdef _WIN32
+    return lastSocketError();
+#else
+    return std::strerror(errno);
+#endif
+}
+
+void closeSocket(FrameSocket socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    ::close(socket);
+#endif
+}
+
+}
 
 SocketServer::SocketServer(int port, MemoryManager* memory_manager)
-    : port_(port), memory_manager_(memory_manager), running_(false), server_fd_(INVALID_SOCKET) {
+    : port_(port), handler_(memory_manager), running_(false), server_fd_(INVALID_SOCKET) {
 
+#ifdef _WIN32
     // Initialize Winsock
     WSADATA wsaData;
     int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
     if (result != 0) {
         throw std::runtime_error("WSAStartup failed: " + std::to_string(result));
     }
+#endif
 }
 
 SocketServer::~SocketServer() {
     stop();
+#ifdef _WIN32
     WSACleanup();
+#endif
 }
 
 void SocketServer::start() {
@@ -35,13 +74,13 @@ void SocketServer::start() {
     // Create socket
     server_fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
     if (server_fd_ == INVALID_SOCKET) {
-        throw std::runtime_error("Failed to create socket: " + std::to_string(WSAGetLastError()));
+        throw std::runtime_error("Failed to create socket: " + lastSocketError());
     }
 
     // Set socket options
-    BOOL opt = TRUE;
+    int opt = 1;
     if (setsockopt(server_fd_, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt)) == SOCKET_ERROR) {
-        throw std::runtime_error("Failed to set socket options: " + std::to_string(WSAGetLastError()));
+        throw std::runtime_error("Failed to set socket options: " + lastSocketError());
     }
 
     // Bind socket to port
@@ -51,12 +90,12 @@ void SocketServer::start() {
     address.sin_port = htons(port_);
 
     if (bind(server_fd_, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
-        throw std::runtime_error("Failed to bind socket: " + std::to_string(WSAGetLastError()));
+        throw std::runtime_error("Failed to bind socket: " + lastSocketError());
     }
 
     // Listen for connections
     if (listen(server_fd_, 5) == SOCKET_ERROR) {
-        throw std::runtime_error("Failed to listen: " + std::to_string(WSAGetLastError()));
+        throw std::runtime_error("Failed to listen: " + lastSocketError());
     }
 
     std::cout << "Socket server listening on port " << port_ << std::endl;
@@ -71,7 +110,11 @@ void SocketServer::stop() {
 
         // Close server socket to interrupt accept()
         if (server_fd_ != INVALID_SOCKET) {
-            closesocket(server_fd_);
+#ifndef _WIN32
+            // On Linux closing the socket does not wake a thread blocked in accept()
+            shutdown(server_fd_, SHUT_RDWR);
+#endif
+            closeSocket(server_fd_);
             server_fd_ = INVALID_SOCKET;
         }
 
@@ -82,21 +125,28 @@ void SocketServer::stop() {
     }
 }
 
+NetworkStats SocketServer::stats() const {
+    return {requests_.load(), syscalls_.load()};
+}
+
 void SocketServer::acceptConnections() {
     struct sockaddr_in client_addr;
-    int addrlen = sizeof(client_addr);
+    socklen_t addrlen = sizeof(client_addr);
 
     while (running_) {
-        SOCKET client_socket = accept(server_fd_, (struct sockaddr*)&client_addr, &addrlen);
+        FrameSocket client_socket = accept(server_fd_, (struct sockaddr*)&client_addr, &addrlen);
+        syscalls_++;
         if (client_socket == INVALID_SOCKET) {
             // Check if server is shutting down
             if (!running_) break;
 
-            std::cerr << "Failed to accept client connection: " << WSAGetLastError() << std::endl;
+            std::cerr << "Failed to accept client connection: " << lastSocketError() << std::endl;
             continue;
         }
 
         std::cout << "Client connected" << std::endl;
+        setNoDelay(client_socket);
+        syscalls_++;
 
         // Handle client in a separate thread and detach it
         std::thread client_thread(&SocketServer::handleClient, this, client_socket);
@@ -104,72 +154,54 @@ void SocketServer::acceptConnections() {
     }
 }
 
-void SocketServer::handleClient(int client_socket) {
+void SocketServer::handleClient(FrameSocket client_socket) {
     try {
+        FrameReader reader;
+        uint64_t reads = 0;
+        std::span<const char> frame;
+        std::vector<char> output;   // Reused for every batch of responses on this connection
         while (running_) {
-            // First, receive the message length
-            int message_length = 0;
-            int recv_result = recv(client_socket, reinterpret_cast<char*>(&message_length), sizeof(int), 0);
-            if (recv_result <= 0) {
-                if (recv_result == 0) {
+            // Receive the next frame; one recv may have brought several
+            FrameStatus status = reader.next(client_socket, frame);
+            syscalls_ += reader.reads() - reads;
+            reads = reader.reads();
+            if (status != FrameStatus::OK) {
+                if (status == FrameStatus::CLOSED) {
                     std::cout << "Client disconnected" << std::endl;
+                } else if (status == FrameStatus::INVALID) {
+                    std::cerr << "[SocketServer] Invalid frame length for socket " << client_socket << std::endl;
                 } else {
-                    std::cerr << "Error receiving message length: " << WSAGetLastError() << std::endl;
+                    std::cerr << "Error receiving message: " << lastSocketError() << std::endl;
                 }
                 break;
             }
 
-            // Then receive the full message
-            std::vector<char> buffer(message_length);
-            int bytes_received = 0;
-            while (bytes_received < message_length) {
-                recv_result = recv(client_socket, buffer.data() + bytes_received,
-                                  message_length - bytes_received, 0);
-                if (recv_result <= 0) {
-                    std::cerr << "Error receiving message data: " << WSAGetLastError() << std::endl;
-                    break;
-                }
-                bytes_received += recv_result;
-            }
-
-            // Si salimos del bucle anterior por un error (recv_result <= 0), 
-            // no debemos continuar procesando el mensaje.
-            if (recv_result <= 0) {
-                break;
-            }
-
-            // Deserialize the message
-            Message request = Message::deserialize(buffer);
+            // Decode the message in place
+            MessageView request = MessageView::decode(frame);
             std::cout << "[SocketServer] Received message of type: " << static_cast<int>(request.getType()) << " for socket " << client_socket << std::endl;
 
             // Process the request
             std::cout << "[SocketServer] Processing request for socket " << client_socket << "..." << std::endl;
-            Message response = processRequest(request);
+            size_t frame_start = beginFrame(output);
+            handler_.process(request, output);
+            endFrame(output, frame_start);
+            requests_++;
             std::cout << "[SocketServer] Request processed for socket " << client_socket << "." << std::endl;
 
-            // Serialize and send the response
-            std::cout << "[SocketServer] Serializing response for socket " << client_socket << "..." << std::endl;
-            std::vector<char> response_data = response.serialize();
-            int response_length = static_cast<int>(response_data.size());
-            std::cout << "[SocketServer] Sending response (length: " << response_length << ") to socket " << client_socket << "..." << std::endl;
-
-            // Send response length
-            std::cout << "[SocketServer] Sending response length for socket " << client_socket << "..." << std::endl;
-            int send_len_result = send(client_socket, reinterpret_cast<char*>(&response_length), sizeof(int), 0);
-            if (send_len_result != sizeof(int)) {
-                std::cerr << "[SocketServer] Error sending response length: " << WSAGetLastError() << " for socket " << client_socket << std::endl;
-                break;
+            // A pipelining client may have sent more requests in the same recv: answer
+            // them all first, then send every response in a single call
+            if (reader.hasFrame()) {
+                continue;
             }
-            std::cout << "[SocketServer] Response length sent for socket " << client_socket << "." << std::endl;
-
-            // Send response data
-            std::cout << "[SocketServer] Sending response data for socket " << client_socket << "..." << std::endl;
-            int send_data_result = send(client_socket, response_data.data(), response_length, 0);
-            if (send_data_result != response_length) {
-                std::cerr << "[SocketServer] Error sending response data: " << WSAGetLastError() << " for socket " << client_socket << std::endl;
+            std::cout << "[SocketServer] Sending responses (length: " << output.size() << ") to socket " << client_socket << "..." << std::endl;
+            bool sent = writeBytes(client_socket, output.data(), output.size());
+            syscalls_++;
+            if (!sent) {
+                std::cerr << "[SocketServer] Error sending response: " << lastSocketError() << " for socket " << client_socket << std::endl;
                 break;
             }
-            std::cout << "[SocketServer] Response data sent for socket " << client_socket << "." << std::endl;
+            std::cout << "[SocketServer] Response sent for socket " << client_socket << "." << std::endl;
+            output.clear();
         }
     }
     catch (const std::exception& e) {
@@ -178,85 +210,6 @@ void SocketServer::handleClient(int client_socket) {
 
     std::cout << "[SocketServer] Closing client socket " << client_socket << "..." << std::endl;
     // Close client socket
-    closesocket(client_socket);
+    closeSocket(client_socket);
     std::cout << "[SocketServer] Client socket " << client_socket << " closed." << std::endl;
 }
-
-Message SocketServer::processRequest(const Message& request) {
-    switch (request.getType()) {
-        case MessageType::CREATE: {
-            size_t size = request.getSize();
-            const std::string& dataType = request.getDataType();
-
-            int id = memory_manager_->create(size, dataType);
-
-            // Prepare response with the ID
-            std::vector<char> response_data(sizeof(int));
-            std::memcpy(response_data.data(), &id, sizeof(int));
-
-            return Message::response(id != -1, response_data);
-        }
-
-        case MessageType::SET: {
-            int id = request.getId();
-            const std::vector<char>& data = request.getData();
-
-            bool success = memory_manager_->set(id, data.data(), data.size());
-
-            return Message::response(success);
-        }
-
-        case MessageType::GET: {
-            int id = request.getId();
-
-            // --- Bloqueo para leer tamaño y datos consistentemente ---
-            size_t blockSize = 0;
-            bool foundBlock = false;
-            {
-                std::lock_guard<std::recursive_mutex> lock(memory_manager_->memory_mutex_);
-                auto it = memory_manager_->blocks_.find(id);
-                if (it != memory_manager_->blocks_.end() && it->second.in_use) {
-                    blockSize = it->second.size;
-                    foundBlock = true;
-                }
-            } // Mutex liberado aquí
-            // --------------------------------------------------------
-
-            if (!foundBlock) {
-                // No se encontró el bloque o no está en uso
-                std::cerr << "[SocketServer] GET failed for ID " << id << ": Block not found or not in use when checking size." << std::endl;
-                return Message::response(false);
-            }
-
-            // Ahora reservamos un buffer del tamaño exacto
-            std::vector<char> result(blockSize);
-
-            // Obtener los datos del bloque (get adquiere su propio lock)
-            bool success = memory_manager_->get(id, result.data(), blockSize);
-
-            // Solo usar los bytes exactos en la respuesta
-            if (success) {
-                return Message::response(true, result);
-            } else {
-                // Loguear por qué get() falló si blockSize > 0
-                 std::cerr << "[SocketServer] GET failed for ID " << id << ": memory_manager_->get returned false unexpectedly." << std::endl;
-                return Message::response(false);
-            }
-        }
-
-        case MessageType::INCREASE_REF_COUNT: {
-            int id = request.getId();
-            bool success = memory_manager_->increaseRefCount(id);
-            return Message::response(success);
-        }
-
-        case MessageType::DECREASE_REF_COUNT: {
-            int id = request.getId();
-            bool success = memory_manager_->decreaseRefCount(id);
-            return Message::response(success);
-        }
-
-        default:
-            return Message::response(false);
-    }
-}
\ No newline at end of file
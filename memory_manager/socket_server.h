@@ -5,33 +5,39 @@
 #ifndef SOCKET_SERVER_H
 #define SOCKET_SERVER_H
 
-#include <winsock2.h> // Include for SOCKET type
 #include <thread>
 #include <vector>
 #include <atomic>
 #include <memory>
 #include <map>
 #include "../protocol/message.h"
+#include "../protocol/frame_io.h"
+#include "network_server.h"
+#include "request_handler.h"
 
 class MemoryManager;
 
-class SocketServer {
+// Thread-per-client backend: every connection gets its own detached thread
+// blocking in recv
+class SocketServer : public NetworkServer {
 public:
     SocketServer(int port, MemoryManager* memory_manager);
-    ~SocketServer();
+    ~SocketServer() override;
 
-    void start();
-    void stop();
+    void start() override;
+    void stop() override;
+    NetworkStats stats() const override;
 
 private:
     void acceptConnections();
-    void handleClient(int client_socket);
-    Message processRequest(const Message& request);
+    void handleClient(FrameSocket client_socket);
 
     int port_;
-    MemoryManager* memory_manager_;
+    RequestHandler handler_;
     std::atomic<bool> running_;
-    SOCKET server_fd_;
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> syscalls_{0};
+    FrameSocket server_fd_;
     std::thread accept_thread_;
 };
 
@@ -0,0 +1,263 @@
+// tlsf_allocator.cpp
+#include "tlsf_allocator.h"
+#include <bit>
+#include <iostream>
+
+TlsfAllocator::TlsfAllocator(size_t pool_size)
+    : fl_bitmap_(0), free_bytes_(0), free_extents_(0) {
+    for (int fl = 0; fl < kFlIndexCount; fl++) {
+        sl_bitmap_[fl] = 0;
+        for (int sl = 0; sl < kSlIndexCount; sl++) {
+            heads_[fl][sl] = kNone;
+        }
+    }
+
+    // The usable pool is a whole number of alignment units below the largest class
+    size_t usable = pool_size & ~(kAlignSize - 1);
+    size_t limit = (size_t(1) << kFlIndexMax) - kAlignSize;
+    if (usable > limit) {
+        usable = limit;
+    }
+    if (usable == 0) {
+        return;
+    }
+
+    nodes_.reserve(1024);
+    uint32_t n = newNode();
+    nodes_[n] = {0, usable, kNone, kNone, kNone, kNone, true};
+    insertFree(n);
+    free_bytes_ = usable;
+}
+
+bool TlsfAllocator::allocate(size_t size, size_t& offset, uint32_t& handle) {
+    if (size == 0) {
+        return false;
+    }
+
+    size_t rounded = (size + kAlignSize - 1) & ~(kAlignSize - 1);
+    if (rounded > free_bytes_) {
+        return false;
+    }
+
+    int fl = 0;
+    int sl = 0;
+    if (!findSuitable(rounded, fl, sl)) {
+        return false;
+    }
+
+    uint32_t n = heads_[fl][sl];
+    removeFree(n);
+
+    // Split off the tail of the extent and keep it free
+    size_t remainder = nodes_[n].size - rounded;
+    if (remainder >= kAlignSize) {
+        uint32_t r = newNode();  // May reallocate nodes_, so only indices are held
+        uint32_t next = nodes_[n].next_phys;
+        nodes_[r] = {nodes_[n].offset + rounded, remainder, n, next, kNone, kNone, true};
+        if (next != kNone) {
+            nodes_[next].prev_phys = r;
+        }
+        nodes_[n].next_phys = r;
+        nodes_[n].size = rounded;
+        insertFree(r);
+    }
+
+    nodes_[n].free = false;
+    free_bytes_ -= nodes_[n].size;
+    offset = nodes_[n].offset;
+    handle = n;
+    return true;
+}
+
+void TlsfAllocator::release(size_t offset, size_t /*size*/, uint32_t handle) {
+    if (handle >= nodes_.size() || nodes_[handle].free || nodes_[handle].offset != offset) {
+        std::cerr << "[TLSF] Ignoring release of unknown extent at offset " << offset << std::endl;
+        return;
+    }
+
+    uint32_t n = handle;
+    nodes_[n].free = true;
+    free_bytes_ += nodes_[n].size;
+
+    // Merge with the physical predecessor...
+    uint32_t prev = nodes_[n].prev_phys;
+    if (prev != kNone && nodes_[prev].free) {
+        removeFree(prev);
+        absorbNext(prev);
+        n = prev;
+    }
+
+    // ...and with the physical successor
+    uint32_t next = nodes_[n].next_phys;
+    if (next != kNone && nodes_[next].free) {
+        removeFree(next);
+        absorbNext(n);
+    }
+
+    insertFree(n);
+}
+
+bool TlsfAllocator::slideDown(size_t& offset, size_t /*size*/, uint32_t handle) {
+    if (handle >= nodes_.size() || nodes_[handle].free || nodes_[handle].offset != offset) {
+        return false;
+    }
+
+    uint32_t b = handle;
+    uint32_t p = nodes_[b].prev_phys;
+    if (p == kNone || !nodes_[p].free) {
+        return false;
+    }
+    removeFree(p);
+
+    // Swap the physical order of the free extent and the block: pp, p, b, nn -> pp, b, p, nn
+    uint32_t pp = nodes_[p].prev_phys;
+    uint32_t nn = nodes_[b].next_phys;
+
+    nodes_[b].offset = nodes_[p].offset;
+    nodes_[p].offset = nodes_[b].offset + nodes_[b].size;
+
+    nodes_[b].prev_phys = pp;
+    nodes_[b].next_phys = p;
+    nodes_[p].prev_phys = b;
+    nodes_[p].next_phys = nn;
+    if (pp != kNone) {
+        nodes_[pp].next_phys = b;
+    }
+    if (nn != kNone) {
+        nodes_[nn].prev_phys = p;
+        if (nodes_[nn].free) {
+            removeFree(nn);
+            absorbNext(p);
+        }
+    }
+
+    insertFree(p);
+    offset = nodes_[b].offset;
+    return true;
+}
+
+size_t TlsfAllocator::largestFreeExtent() const {
+    if (fl_bitmap_ == 0) {
+        return 0;
+    }
+
+    // The highest non-empty list holds the largest extents; scan just that list
+    int fl = 63 - std::countl_zero(fl_bitmap_);
+    int sl = 31 - std::countl_zero(sl_bitmap_[fl]);
+    size_t largest = 0;
+    for (uint32_t n = heads_[fl][sl]; n != kNone; n = nodes_[n].next_free) {
+        if (nodes_[n].size > largest) {
+            largest = nodes_[n].size;
+        }
+    }
+    return largest;
+}
+
+void TlsfAllocator::mappingInsert(size_t size, int& fl, int& sl) {
+    if (size < kSmallBlockSize) {
+        // Small sizes are split linearly into the first level
+        fl = 0;
+        sl = static_cast<int>(size / (kSmallBlockSize / kSlIndexCount));
+    } else {
+        int f = static_cast<int>(std::bit_width(size)) - 1;
+        sl = static_cast<int>((size >> (f - kSlIndexLog2)) ^ (size_t(1) << kSlIndexLog2));
+        fl = f - (kFlIndexShift - 1);
+    }
+}
+
+bool TlsfAllocator::findSuitable(size_t size, int& fl, int& sl) const {
+    // Round up to the next list boundary so any extent in the chosen list fits
+    if (size >= kSmallBlockSize) {
+        int f = static_cast<int>(std::bit_width(size)) - 1;
+        size += (size_t(1) << (f - kSlIndexLog2)) - 1;
+    }
+    mappingInsert(size, fl, sl);
+    if (fl >= kFlIndexCount) {
+        return false;
+    }
+
+    uint32_t sl_map = sl_bitmap_[fl] & (~0u << sl);
+    if (sl_map == 0) {
+        // Nothing in this first level: take the smallest non-empty larger one
+        uint64_t fl_map = fl_bitmap_ & (~uint64_t(0) << (fl + 1));
+        if (fl_map == 0) {
+            return false;
+        }
+        fl = std::countr_zero(fl_map);
+        sl_map = sl_bitmap_[fl];
+    }
+    sl = std::countr_zero(sl_map);
+    return true;
+}
+
+void TlsfAllocator::insertFree(uint32_t n) {
+    int fl = 0;
+    int sl = 0;
+    mappingInsert(nodes_[n].size, fl, sl);
+
+    uint32_t head = heads_[fl][sl];
+    nodes_[n].free = true;
+    nodes_[n].prev_free = kNone;
+    nodes_[n].next_free = head;
+    if (head != kNone) {
+        nodes_[head].prev_free = n;
+    }
+    heads_[fl][sl] = n;
+
+    fl_bitmap_ |= uint64_t(1) << fl;
+    sl_bitmap_[fl] |= 1u << sl;
+    free_extents_++;
+}
+
+void TlsfAllocator::removeFree(uint32_t n) {
+    int fl = 0;
+    int sl = 0;
+    mappingInsert(nodes_[n].size, fl, sl);
+
+    uint32_t prev = nodes_[n].prev_free;
+    uint32_t next = nodes_[n].next_free;
+    if (prev != kNone) {
+        nodes_[prev].next_free = next;
+    } else {
+        heads_[fl][sl] = next;
+    }
+    if (next != kNone) {
+        nodes_[next].prev_free = prev;
+    }
+
+    if (heads_[fl][sl] == kNone) {
+        sl_bitmap_[fl] &= ~(1u << sl);
+        if (sl_bitmap_[fl] == 0) {
+            fl_bitmap_ &= ~(uint64_t(1) << fl);
+        }
+    }
+    free_extents_--;
+}
+
+void TlsfAllocator::absorbNext(uint32_t n) {
+    // Grows n over its physical successor, which must already be off the free lists
+    uint32_t next = nodes_[n].next_phys;
+    uint32_t after = nodes_[next].next_phys;
+    nodes_[n].size += nodes_[next].size;
+    nodes_[n].next_phys = after;
+    if (after != kNone) {
+        nodes_[after].prev_phys = n;
+    }
+    deleteNode(next);
+}
+
+uint32_t TlsfAllocator::newNode() {
+    if (!unused_nodes_.empty()) {
+        uint32_t n = unused_nodes_.back();
+        unused_nodes_.pop_back();
+        return n;
+    }
+    nodes_.push_back({});
+    return static_cast<uint32_t>(nodes_.size() - 1);
+}
+
+void TlsfAllocator::deleteNode(uint32_t n) {
+    nodes_[n].free = false;
+    nodes_[n].offset = SIZE_MAX;
+    unused_nodes_.push_back(n);
+}
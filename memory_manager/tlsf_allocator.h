@@ -0,0 +1,73 @@
+#ifndef TLSF_ALLOCATOR_H
+#define TLSF_ALLOCATOR_H
+
+#include "allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Two-Level Segregated Fit allocator.
+// Free extents are kept in segregated lists indexed by a first level (power of
+// two) and a second level (32 linear subdivisions of that power of two). Two
+// bitmaps record which lists are non-empty, so finding a fitting extent,
+// splitting it and merging on release are all constant time.
+//
+// The bookkeeping lives outside the pool: every extent (free or allocated) is a
+// node with links to its physical neighbours, and the node index is the handle
+// stored with the block. Sizes are rounded up to 8 bytes.
+class TlsfAllocator : public Allocator {
+public:
+    explicit TlsfAllocator(size_t pool_size);
+
+    bool allocate(size_t size, size_t& offset, uint32_t& handle) override;
+    void release(size_t offset, size_t size, uint32_t handle) override;
+    bool slideDown(size_t& offset, size_t size, uint32_t handle) override;
+
+    size_t freeBytes() const override { return free_bytes_; }
+    size_t freeExtentCount() const override { return free_extents_; }
+    size_t largestFreeExtent() const override;
+    const char* name() const override { return "tlsf"; }
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    static constexpr int kAlignLog2 = 3;
+    static constexpr size_t kAlignSize = size_t(1) << kAlignLog2;
+    static constexpr int kSlIndexLog2 = 5;
+    static constexpr int kSlIndexCount = 1 << kSlIndexLog2;
+    static constexpr int kFlIndexShift = kSlIndexLog2 + kAlignLog2;
+    static constexpr size_t kSmallBlockSize = size_t(1) << kFlIndexShift;
+    static constexpr int kFlIndexMax = 40;  // Extents smaller than 1 TB
+    static constexpr int kFlIndexCount = kFlIndexMax - kFlIndexShift + 1;
+
+    struct Node {
+        size_t offset;
+        size_t size;
+        uint32_t prev_phys;
+        uint32_t next_phys;
+        uint32_t prev_free;
+        uint32_t next_free;
+        bool free;
+    };
+
+    static void mappingInsert(size_t size, int& fl, int& sl);
+    bool findSuitable(size_t size, int& fl, int& sl) const;
+
+    void insertFree(uint32_t n);
+    void removeFree(uint32_t n);
+    void absorbNext(uint32_t n);
+    uint32_t newNode();
+    void deleteNode(uint32_t n);
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> unused_nodes_;
+
+    uint64_t fl_bitmap_;
+    uint32_t sl_bitmap_[kFlIndexCount];
+    uint32_t heads_[kFlIndexCount][kSlIndexCount];
+
+    size_t free_bytes_;
+    size_t free_extents_;
+};
+
+#endif //TLSF_ALLOCATOR_H
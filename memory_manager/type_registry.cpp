@@ -0,0 +1,27 @@
+// type_registry.cpp
+#include "type_registry.h"
+#include <iomanip>
+#include <sstream>
+
+bool TypeRegistry::add(uint32_t type_id, const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto result = names_.emplace(type_id, name);
+    return result.second || result.first->second == name;
+}
+
+bool TypeRegistry::contains(uint32_t type_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.count(type_id) != 0;
+}
+
+std::string TypeRegistry::nameOf(uint32_t type_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = names_.find(type_id);
+    if (it != names_.end()) {
+        return it->second;
+    }
+
+    std::ostringstream unknown;
+    unknown << "<type 0x" << std::hex << std::setw(8) << std::setfill('0') << type_id << ">";
+    return unknown.str();
+}
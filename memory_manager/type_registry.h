@@ -0,0 +1,28 @@
+#ifndef TYPE_REGISTRY_H
+#define TYPE_REGISTRY_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Maps the 32-bit type ids carried by CREATE back to the type names clients
+// registered with REGISTER_TYPE. Blocks only store the id; names are looked
+// up when a dump is written.
+class TypeRegistry {
+public:
+    // Records the name of a type id. Fails if the id is already taken by a
+    // different name (hash collision); registering the same pair again is a no-op.
+    bool add(uint32_t type_id, const std::string& name);
+
+    bool contains(uint32_t type_id) const;
+
+    // Registered name of a type id, or a placeholder showing the raw id
+    std::string nameOf(uint32_t type_id) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, std::string> names_;
+};
+
+#endif //TYPE_REGISTRY_H
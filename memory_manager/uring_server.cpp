@@ -0,0 +1,641 @@
+// uring_server.cpp
+#include "uring_server.h"
+
+#ifdef HAVE_IO_URING
+
+#include "../protocol/frame_io.h"
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr unsigned kRingEntries = 256;
+constexpr unsigned kBufferCount = 256;      // Power of two, as the buffer ring requires
+constexpr size_t kBufferSize = 16 * 1024;
+constexpr uint16_t kBufferGroup = 0;
+
+std::runtime_error socketError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+uint64_t userData(uint64_t id, uint64_t operation) {
+    return id << 8 | operation;
+}
+
+int enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+}
+
+// --- Ring ---
+
+UringServer::Ring::~Ring() {
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_map_ && cq_map_ != sq_map_) {
+        munmap(cq_map_, cq_map_size_);
+    }
+    if (sq_map_) {
+        munmap(sq_map_, sq_map_size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool UringServer::Ring::setup(unsigned entries) {
+    io_uring_params params{};
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+        return false;
+    }
+
+    sq_map_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_map_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_map_size_ = cq_map_size_ = std::max(sq_map_size_, cq_map_size_);
+    }
+
+    sq_map_ = mmap(nullptr, sq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_map_ == MAP_FAILED) {
+        sq_map_ = nullptr;
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_map_ = sq_map_;
+    } else {
+        cq_map_ = mmap(nullptr, cq_map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_map_ == MAP_FAILED) {
+            cq_map_ = nullptr;
+            return false;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_map_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+
+    char* cq = static_cast<char*>(cq_map_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    return true;
+}
+
+io_uring_sqe* UringServer::Ring::nextSqe() {
+    unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+    unsigned tail = *sq_tail_ + pending_;
+    if (tail - head >= sq_entries_) {
+        return nullptr;
+    }
+    unsigned index = tail & sq_mask_;
+    sq_array_[index] = index;
+    pending_++;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int UringServer::Ring::submitAndWait(unsigned wait_for) {
+    // Publish the new entries, then submit everything the kernel hasn't taken yet
+    unsigned tail = *sq_tail_ + pending_;
+    std::atomic_ref<unsigned>(*sq_tail_).store(tail, std::memory_order_release);
+    pending_ = 0;
+    unsigned to_submit = tail - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+    int result = enter(fd_, to_submit, wait_for, wait_for ? IORING_ENTER_GETEVENTS : 0);
+    return result < 0 ? -errno : result;
+}
+
+template <typename F>
+unsigned UringServer::Ring::forEachCompletion(F&& f) {
+    unsigned head = *cq_head_;
+    unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+    unsigned count = tail - head;
+    for (; head != tail; head++) {
+        f(cqes_[head & cq_mask_]);
+    }
+    std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+    return count;
+}
+
+// --- UringServer ---
+
+UringServer::Connection::~Connection() {
+    ::close(fd);
+}
+
+UringServer::UringServer(int port, MemoryManager* memory_manager, size_t workers)
+    : port_(port), handler_(memory_manager), worker_count_(workers), running_(false) {
+}
+
+UringServer::~UringServer() {
+    stop();
+    if (buffer_ring_) {
+        munmap(buffer_ring_, kBufferCount * sizeof(io_uring_buf));
+    }
+}
+
+bool UringServer::isSupported() {
+    Ring ring;
+    if (!ring.setup(8)) {
+        return false;   // No io_uring, or disabled (io_uring_disabled sysctl, seccomp)
+    }
+
+    std::vector<char> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (syscall(__NR_io_uring_register, ring.fd(), IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return false;
+    }
+    auto supported = [probe](int op) {
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+    };
+    // The probe lists opcodes, not flags: multishot recv arrived in Linux 6.0
+    // together with IORING_OP_SEND_ZC, so that opcode stands in for it
+    return supported(IORING_OP_ACCEPT) && supported(IORING_OP_RECV) && supported(IORING_OP_SEND) &&
+           supported(IORING_OP_READ) && supported(IORING_OP_SEND_ZC);
+}
+
+void UringServer::start() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw socketError("Failed to create socket");
+    }
+    int opt = 1;
+    if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        throw socketError("Failed to set socket options");
+    }
+    setNoDelay(listen_fd_);     // Accepted sockets inherit it
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port_);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        throw socketError("Failed to bind socket");
+    }
+    if (listen(listen_fd_, SOMAXCONN) < 0) {
+        throw socketError("Failed to listen");
+    }
+
+    wake_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0 || !ring_.setup(kRingEntries)) {
+        throw socketError("Failed to set up io_uring");
+    }
+
+    // Lend the receive buffers to the kernel through a provided buffer ring
+    void* ring_memory = mmap(nullptr, kBufferCount * sizeof(io_uring_buf), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring_memory == MAP_FAILED) {
+        throw socketError("Failed to allocate the buffer ring");
+    }
+    buffer_ring_ = static_cast<io_uring_buf_ring*>(ring_memory);
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(buffer_ring_);
+    registration.ring_entries = kBufferCount;
+    registration.bgid = kBufferGroup;
+    if (syscall(__NR_io_uring_register, ring_.fd(), IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        throw socketError("Failed to register the buffer ring");
+    }
+    buffers_.resize(kBufferCount * kBufferSize);
+    for (unsigned i = 0; i < kBufferCount; i++) {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+
+    std::cout << "Socket server listening on port " << port_ << " (io_uring, "
+              << worker_count_ << " worker(s))" << std::endl;
+
+    running_ = true;
+    armAccept();
+    armWake();
+    io_thread_ = std::thread(&UringServer::runIoLoop, this);
+    for (size_t i = 0; i < worker_count_; i++) {
+        workers_.emplace_back(&UringServer::runWorker, this);
+    }
+}
+
+void UringServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+        std::cerr << "[UringServer] Failed to wake the I/O thread: " << std::strerror(errno) << std::endl;
+    }
+    if (io_thread_.joinable()) {
+        io_thread_.join();
+    }
+
+    ready_cv_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    ready_.clear();
+
+    ::close(listen_fd_);
+    ::close(wake_fd_);
+    listen_fd_ = wake_fd_ = -1;
+}
+
+NetworkStats UringServer::stats() const {
+    return {requests_.load(), syscalls_.load()};
+}
+
+io_uring_sqe* UringServer::sqe() {
+    io_uring_sqe* entry = ring_.nextSqe();
+    while (!entry) {
+        // Queue full: hand it to the kernel now and keep going
+        ring_.submitAndWait(0);
+        syscalls_++;
+        entry = ring_.nextSqe();
+    }
+    return entry;
+}
+
+void UringServer::armAccept() {
+    io_uring_sqe* entry = sqe();
+    entry->opcode = IORING_OP_ACCEPT;
+    entry->fd = listen_fd_;
+    entry->accept_flags = SOCK_CLOEXEC;
+    entry->ioprio = IORING_ACCEPT_MULTISHOT;
+    entry->user_data = userData(0, ACCEPT);
+}
+
+void UringServer::armWake() {
+    io_uring_sqe* entry = sqe();
+    entry->opcode = IORING_OP_READ;
+    entry->fd = wake_fd_;
+    entry->addr = reinterpret_cast<uint64_t>(&wake_value_);
+    entry->len = sizeof(wake_value_);
+    entry->user_data = userData(0, WAKE);
+}
+
+void UringServer::armRecv(uint64_t id, Connection& connection) {
+    io_uring_sqe* entry = sqe();
+    entry->opcode = IORING_OP_RECV;
+    entry->fd = connection.fd;
+    entry->ioprio = IORING_RECV_MULTISHOT;
+    entry->flags = IOSQE_BUFFER_SELECT;
+    entry->buf_group = kBufferGroup;
+    entry->user_data = userData(id, RECV);
+    connection.recv_armed = true;
+}
+
+void UringServer::startSend(uint64_t id, Connection& connection) {
+    if (connection.sending_offset == connection.sending.size()) {
+        connection.sending.clear();
+        connection.sending_offset = 0;
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        std::swap(connection.sending, connection.output);
+    }
+    if (connection.sending.empty()) {
+        return;
+    }
+
+    io_uring_sqe* entry = sqe();
+    entry->opcode = IORING_OP_SEND;
+    entry->fd = connection.fd;
+    entry->addr = reinterpret_cast<uint64_t>(connection.sending.data() + connection.sending_offset);
+    entry->len = static_cast<uint32_t>(connection.sending.size() - connection.sending_offset);
+    entry->msg_flags = MSG_NOSIGNAL;
+    entry->user_data = userData(id, SEND);
+    connection.send_in_flight = true;
+}
+
+void UringServer::recycleBuffer(uint16_t buffer_id) {
+    // The entries start at the ring itself (bufs[] sits 8 bytes further in C++,
+    // where the header's empty struct has a size). The ring tail shares memory
+    // with the first entry's resv field, so only the other fields are written.
+    std::atomic_ref<uint16_t> tail(buffer_ring_->tail);
+    uint16_t position = tail.load(std::memory_order_relaxed);
+    io_uring_buf& buffer = reinterpret_cast<io_uring_buf*>(buffer_ring_)[position & (kBufferCount - 1)];
+    buffer.addr = reinterpret_cast<uint64_t>(buffers_.data() + buffer_id * kBufferSize);
+    buffer.len = kBufferSize;
+    buffer.bid = buffer_id;
+    tail.store(static_cast<uint16_t>(position + 1), std::memory_order_release);
+}
+
+void UringServer::runIoLoop() {
+    while (running_) {
+        // One system call submits everything queued and waits for the next completion
+        int result = ring_.submitAndWait(1);
+        syscalls_++;
+        if (result < 0 && result != -EINTR && result != -EBUSY) {
+            std::cerr << "[UringServer] io_uring_enter failed: " << std::strerror(-result) << std::endl;
+            break;
+        }
+
+        ring_.forEachCompletion([this](const io_uring_cqe& cqe) {
+            uint64_t id = cqe.user_data >> 8;
+            switch (cqe.user_data & 0xff) {
+                case ACCEPT: onAccept(cqe.res, cqe.flags); break;
+                case RECV: onRecv(id, cqe.res, cqe.flags); break;
+                case SEND: onSend(id, cqe.res); break;
+                case WAKE: armWake(); break;
+            }
+        });
+
+        // Pick up the responses workers finished meanwhile. Clearing the flag
+        // first means a response added after this point wakes the loop again.
+        wake_pending_.store(false);
+        sendResponses();
+    }
+
+    // Shut every socket down so their pending operations complete, and wait for
+    // them: the kernel may still be using the connections' buffers
+    shutdown(listen_fd_, SHUT_RDWR);
+    for (auto& entry : connections_) {
+        shutdown(entry.second->fd, SHUT_RDWR);
+    }
+    for (int attempt = 0; attempt < 1000 && !connections_.empty(); attempt++) {
+        ring_.submitAndWait(0);
+        ring_.forEachCompletion([this](const io_uring_cqe& cqe) {
+            uint64_t id = cqe.user_data >> 8;
+            if ((cqe.user_data & 0xff) == RECV) {
+                onRecv(id, cqe.res, cqe.flags);
+            } else if ((cqe.user_data & 0xff) == SEND) {
+                onSend(id, cqe.res);
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    connections_.clear();
+}
+
+void UringServer::onAccept(int result, uint32_t flags) {
+    if (result >= 0) {
+        uint64_t id = next_id_++;
+        auto connection = std::make_shared<Connection>(result);
+        connections_[id] = connection;
+        armRecv(id, *connection);
+        std::cout << "Client connected" << std::endl;
+    } else if (running_) {
+        std::cerr << "Failed to accept client connection: " << std::strerror(-result) << std::endl;
+    }
+
+    if (!(flags & IORING_CQE_F_MORE) && running_) {
+        armAccept();
+    }
+}
+
+void UringServer::onRecv(uint64_t id, int result, uint32_t flags) {
+    auto it = connections_.find(id);
+    std::shared_ptr<Connection> connection = it != connections_.end() ? it->second : nullptr;
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        auto buffer_id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        if (connection && result > 0) {
+            const char* data = buffers_.data() + buffer_id * kBufferSize;
+            connection->input.insert(connection->input.end(), data, data + result);
+        }
+        recycleBuffer(buffer_id);
+    }
+    if (!connection) {
+        return;
+    }
+
+    bool more = flags & IORING_CQE_F_MORE;
+    if (!more) {
+        connection->recv_armed = false;
+    }
+
+    if (result == 0) {
+        // The client may have shut down only its sending side after pipelining its
+        // last requests: those are still served, and the connection closes once
+        // every response is out
+        std::cout << "Client disconnected" << std::endl;
+        connection->draining = true;
+        if (finished(*connection)) {
+            close(id);
+        }
+        return;
+    }
+    if (result < 0 && result != -ENOBUFS) {
+        if (result != -ECANCELED) {
+            std::cerr << "Error receiving from connection " << id << ": " << std::strerror(-result) << std::endl;
+        }
+        close(id);
+        return;
+    }
+
+    // Cut the complete frames: a 4-byte length, then that many bytes of message
+    std::vector<char>& input = connection->input;
+    std::deque<std::vector<char>> frames;
+    size_t position = 0;
+    bool invalid = false;
+    while (input.size() - position >= sizeof(int)) {
+        int length;
+        std::memcpy(&length, input.data() + position, sizeof(int));
+        if (length < 0) {
+            invalid = true;
+            break;
+        }
+        if (input.size() - position - sizeof(int) < static_cast<size_t>(length)) {
+            break;
+        }
+        auto begin = input.begin() + position + sizeof(int);
+        frames.emplace_back(begin, begin + length);
+        position += sizeof(int) + length;
+    }
+    input.erase(input.begin(), input.begin() + position);
+    if (invalid) {
+        std::cerr << "[UringServer] Invalid frame length on connection " << id << std::endl;
+        close(id);
+        return;
+    }
+
+    bool schedule = false;
+    if (!frames.empty()) {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        for (auto& frame : frames) {
+            connection->requests.push_back(std::move(frame));
+        }
+        schedule = !connection->scheduled;
+        connection->scheduled = true;
+    }
+    if (schedule) {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        ready_.emplace_back(id, connection);
+        ready_cv_.notify_one();
+    }
+
+    // A multishot recv also stops when the buffer ring runs dry (-ENOBUFS)
+    if (!more && running_) {
+        armRecv(id, *connection);
+    }
+}
+
+void UringServer::onSend(uint64_t id, int result) {
+    auto it = connections_.find(id);
+    if (it == connections_.end()) {
+        return;
+    }
+    Connection& connection = *it->second;
+    connection.send_in_flight = false;
+
+    if (result < 0) {
+        if (result != -ECANCELED && running_) {
+            std::cerr << "[UringServer] Error sending to connection " << id << ": " << std::strerror(-result) << std::endl;
+        }
+        connection.sending_offset = connection.sending.size();
+        close(id);
+        return;
+    }
+
+    connection.sending_offset += result;
+    bool closed;
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        closed = connection.closed;
+    }
+    if (closed) {
+        close(id);
+        return;
+    }
+    startSend(id, connection);  // The rest of this buffer, or the responses queued meanwhile
+    if (finished(connection)) {
+        close(id);
+    }
+}
+
+void UringServer::sendResponses() {
+    std::vector<uint64_t> ids;
+    {
+        std::lock_guard<std::mutex> lock(responses_mutex_);
+        ids.swap(responses_);
+    }
+    for (uint64_t id : ids) {
+        auto it = connections_.find(id);
+        if (it == connections_.end() || it->second->send_in_flight) {
+            continue;
+        }
+        startSend(id, *it->second);
+        if (finished(*it->second)) {
+            close(id);
+        }
+    }
+}
+
+bool UringServer::finished(Connection& connection) {
+    if (!connection.draining || connection.send_in_flight) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(connection.mutex);
+    return !connection.scheduled && connection.output.empty();
+}
+
+// Stops serving a connection. It is dropped once the kernel is done with it:
+// shutting the socket down makes its multishot recv complete.
+void UringServer::close(uint64_t id) {
+    auto it = connections_.find(id);
+    if (it == connections_.end()) {
+        return;
+    }
+    Connection& connection = *it->second;
+    bool was_closed;
+    {
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        was_closed = connection.closed;
+        connection.closed = true;
+    }
+    if (!was_closed && connection.recv_armed) {
+        shutdown(connection.fd, SHUT_RDWR);
+        syscalls_++;
+    }
+    if (!connection.recv_armed && !connection.send_in_flight) {
+        connections_.erase(it);
+    }
+}
+
+void UringServer::runWorker() {
+    std::vector<char> response;
+    while (true) {
+        std::pair<uint64_t, std::shared_ptr<Connection>> next;
+        {
+            std::unique_lock<std::mutex> lock(ready_mutex_);
+            ready_cv_.wait(lock, [this]() { return !ready_.empty() || !running_; });
+            if (ready_.empty()) {
+                return;
+            }
+            next = std::move(ready_.front());
+            ready_.pop_front();
+        }
+        Connection& connection = *next.second;
+
+        std::vector<char> frame;
+        {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            if (connection.closed || connection.requests.empty()) {
+                connection.scheduled = false;
+                continue;
+            }
+            frame = std::move(connection.requests.front());
+            connection.requests.pop_front();
+        }
+
+        // Encoded straight into this worker's reusable buffer, framed, in the request's format
+        response.clear();
+        size_t frame_start = beginFrame(response);
+        try {
+            handler_.process(MessageView::decode(frame), response);
+        } catch (const std::exception& e) {
+            std::cerr << "[UringServer] Failed to process request on connection " << next.first << ": " << e.what() << std::endl;
+            response.resize(frame_start + sizeof(int));
+            Message::appendResponse(response, MessageView::formatOf(frame), 0, false);
+        }
+        endFrame(response, frame_start);
+        requests_++;
+
+        bool more;
+        {
+            std::lock_guard<std::mutex> lock(connection.mutex);
+            std::vector<char>& output = connection.output;
+            output.insert(output.end(), response.begin(), response.end());
+
+            // One request per turn, so a busy client can't hold a worker
+            more = !connection.closed && !connection.requests.empty();
+            connection.scheduled = more;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(responses_mutex_);
+            responses_.push_back(next.first);
+        }
+        if (!wake_pending_.exchange(true)) {
+            uint64_t one = 1;
+            if (write(wake_fd_, &one, sizeof(one)) > 0) {
+                syscalls_++;
+            }
+        }
+
+        if (more) {
+            std::lock_guard<std::mutex> lock(ready_mutex_);
+            ready_.push_back(std::move(next));
+            ready_cv_.notify_one();
+        }
+    }
+}
+
+#endif //HAVE_IO_URING
@@ -0,0 +1,162 @@
+#ifndef URING_SERVER_H
+#define URING_SERVER_H
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "network_server.h"
+#include "request_handler.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+class MemoryManager;
+
+// io_uring backend for Linux 6.0 and later, talking to the kernel through the
+// raw system calls (no liburing).
+//
+// One thread owns the ring and does all the socket I/O; requests are served by
+// a fixed worker pool like in EpollServer. Instead of one system call per
+// recv/send, the I/O thread queues every operation it needs as a submission
+// entry and hands the whole batch to the kernel together with the wait for
+// the next completions, in a single io_uring_enter:
+//
+//  - A multishot accept produces one completion per new client.
+//  - Each connection has one multishot recv. The kernel picks a buffer from a
+//    ring of buffers registered up front (a provided buffer ring), so no read
+//    buffer is tied up by idle connections. Frames are cut from the bytes and
+//    the buffer is handed straight back to the kernel.
+//  - Responses are sent with one send per connection in flight; whatever
+//    workers add meanwhile goes out with the next one.
+//  - Workers wake the I/O thread through an eventfd read that stays queued on
+//    the ring, and only when it isn't already awake.
+class UringServer : public NetworkServer {
+public:
+    UringServer(int port, MemoryManager* memory_manager, size_t workers);
+    ~UringServer() override;
+
+    void start() override;
+    void stop() override;
+    NetworkStats stats() const override;
+
+    // Whether this kernel has everything the backend needs (and allows io_uring at all)
+    static bool isSupported();
+
+private:
+    // Kernel-shared submission and completion rings
+    class Ring {
+    public:
+        ~Ring();
+
+        bool setup(unsigned entries);
+        io_uring_sqe* nextSqe();    // nullptr if the submission queue is full
+        int submitAndWait(unsigned wait_for);
+
+        // Calls f(cqe) for every completion available and marks them consumed
+        template <typename F>
+        unsigned forEachCompletion(F&& f);
+
+        int fd() const { return fd_; }
+
+    private:
+        int fd_ = -1;
+        void* sq_map_ = nullptr;
+        size_t sq_map_size_ = 0;
+        void* cq_map_ = nullptr;
+        size_t cq_map_size_ = 0;
+        io_uring_sqe* sqes_ = nullptr;
+        size_t sqes_size_ = 0;
+
+        unsigned* sq_head_ = nullptr;
+        unsigned* sq_tail_ = nullptr;
+        unsigned* sq_array_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned sq_entries_ = 0;
+        unsigned pending_ = 0;      // Entries filled in since the last submit
+
+        unsigned* cq_head_ = nullptr;
+        unsigned* cq_tail_ = nullptr;
+        io_uring_cqe* cqes_ = nullptr;
+        unsigned cq_mask_ = 0;
+    };
+
+    struct Connection {
+        explicit Connection(int fd) : fd(fd) {}
+        ~Connection();
+
+        int fd;
+        std::vector<char> input;        // I/O thread only
+        std::vector<char> sending;      // I/O thread only; the kernel reads it during a send
+        size_t sending_offset = 0;
+        bool send_in_flight = false;    // I/O thread only
+        bool recv_armed = false;        // I/O thread only
+        bool draining = false;          // I/O thread only; the client stopped sending
+
+        std::mutex mutex;               // Guards everything below
+        std::deque<std::vector<char>> requests;
+        bool scheduled = false;
+        bool closed = false;
+        std::vector<char> output;       // Responses not handed to a send yet
+    };
+
+    // What a completion belongs to, in the low bits of its user_data
+    enum Operation : uint64_t { ACCEPT = 1, RECV, SEND, WAKE };
+
+    void runIoLoop();
+    void runWorker();
+    void armAccept();
+    void armWake();
+    void armRecv(uint64_t id, Connection& connection);
+    void startSend(uint64_t id, Connection& connection);
+    void onAccept(int result, uint32_t flags);
+    void onRecv(uint64_t id, int result, uint32_t flags);
+    void onSend(uint64_t id, int result);
+    void sendResponses();
+    bool finished(Connection& connection);  // Draining, and nothing left to answer or send
+    void recycleBuffer(uint16_t buffer_id);
+    void close(uint64_t id);
+    io_uring_sqe* sqe();            // Submits early if the queue is full
+
+    int port_;
+    RequestHandler handler_;
+    size_t worker_count_;
+    std::atomic<bool> running_;
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    uint64_t wake_value_ = 0;       // Target of the queued eventfd read
+
+    Ring ring_;
+    io_uring_buf_ring* buffer_ring_ = nullptr;
+    std::vector<char> buffers_;     // kBufferCount buffers of kBufferSize bytes lent to the kernel
+
+    std::unordered_map<uint64_t, std::shared_ptr<Connection>> connections_;   // I/O thread only
+    uint64_t next_id_ = 1;
+
+    std::mutex ready_mutex_;
+    std::condition_variable ready_cv_;
+    std::deque<std::pair<uint64_t, std::shared_ptr<Connection>>> ready_;
+
+    std::mutex responses_mutex_;
+    std::vector<uint64_t> responses_;       // Connections with new output
+    std::atomic<bool> wake_pending_{false};
+
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> syscalls_{0};
+
+    std::thread io_thread_;
+    std::vector<std::thread> workers_;
+};
+
+#endif
+
+#endif //URING_SERVER_H
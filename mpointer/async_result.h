@@ -0,0 +1,76 @@
+#ifndef ASYNC_RESULT_H
+#define ASYNC_RESULT_H
+
+#include <coroutine>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+// Resultado de una petición ya enviada al Memory Manager. Es un std::future
+// (get, wait, wait_for...) y además se puede esperar con co_await desde una
+// corrutina, sin bloquear ningún hilo mientras llega la respuesta.
+//
+// La petición sale al crear el AsyncResult, no al esperarlo: para solapar
+// varias idas y vueltas basta con lanzarlas todas y esperarlas después.
+//
+// Una corrutina suspendida se reanuda en el hilo de continuaciones del
+// SocketClient, nunca en el hilo que lee del socket, así que después del
+// co_await puede volver a usar cualquier operación, también las bloqueantes.
+template <typename T>
+class AsyncResult : public std::future<T> {
+public:
+    // Comparte el momento en que llega la respuesta con la corrutina que la espera
+    class State {
+    public:
+        explicit State(std::function<void(std::coroutine_handle<>)> resume) : resume_(std::move(resume)) {}
+
+        // Lo llama quien cumple la promesa, después de hacerlo
+        void complete() {
+            std::coroutine_handle<> waiter;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                done_ = true;
+                waiter = waiter_;
+            }
+            if (waiter) {
+                resume_(waiter);
+            }
+        }
+
+        // false si la respuesta ya llegó y no hace falta suspender
+        bool suspend(std::coroutine_handle<> waiter) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (done_) {
+                return false;
+            }
+            waiter_ = waiter;
+            return true;
+        }
+
+    private:
+        std::function<void(std::coroutine_handle<>)> resume_;
+        std::mutex mutex_;
+        bool done_ = false;
+        std::coroutine_handle<> waiter_;
+    };
+
+    AsyncResult(std::future<T> future, std::shared_ptr<State> state)
+        : std::future<T>(std::move(future)), state_(std::move(state)) {}
+
+    // Interfaz de awaitable
+    bool await_ready() const {
+        return this->wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    bool await_suspend(std::coroutine_handle<> waiter) {
+        return state_->suspend(waiter);
+    }
+    T await_resume() {
+        return this->get();
+    }
+
+private:
+    std::shared_ptr<State> state_;
+};
+
+#endif //ASYNC_RESULT_H
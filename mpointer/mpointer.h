@@ -12,7 +12,12 @@
 #include <iostream>
 #include <vector>
 #include <cstring>
+#include <type_traits>
+#include <concepts>
+#include <atomic>
+#include <utility>
 #include "socket_client.h"
+#include "../protocol/type_id.h"
 
 // Estructura para mantener la conexión estática compartida
 struct MPointerConnection {
@@ -30,6 +35,24 @@ struct MPointerConnection {
     }
 };
 
+// Offset de un miembro a partir de su puntero a miembro, lo mismo que offsetof
+// pero sin nombrar el campo. Como offsetof, sólo para tipos de disposición
+// estándar. Se mide sobre un T real, construido por defecto una vez por tipo
+// la primera vez que se usa, así que vale también para T no triviales.
+template <typename T, typename M>
+size_t memberOffset(M T::* member) {
+    static_assert(std::is_standard_layout_v<T>, "memberOffset: T debe ser de disposición estándar");
+    static const T object{};
+    return reinterpret_cast<const char*>(&(object.*member)) - reinterpret_cast<const char*>(&object);
+}
+
+// Enteros que el servidor sabe actualizar atómicamente (mensaje ATOMIC)
+template <typename V>
+concept AtomicInteger = std::integral<V> && (sizeof(V) == 4 || sizeof(V) == 8);
+
+template <typename T>
+class MPointerRef;
+
 template <typename T>
 class MPointer {
 private:
@@ -78,7 +101,97 @@ private:
         }
     };
 
+    // Un campo de *ptr: lee y escribe sólo sus bytes (GET_RANGE/SET_RANGE)
+    template <typename M>
+    class FieldProxy {
+        int proxy_id_;
+        size_t offset_;
+    public:
+        FieldProxy(int id, size_t offset) : proxy_id_(id), offset_(offset) {}
+
+        // Escritura: ptr.field(&T::campo) = value
+        FieldProxy& operator=(const M& value) {
+            std::vector<char> data(sizeof(M));
+            std::memcpy(data.data(), &value, sizeof(M));
+            if (!MPointerConnection::client_->setMemoryRange(proxy_id_, offset_, data)) {
+                throw std::runtime_error("Proxy: Error al asignar el campo del MPointer");
+            }
+            return *this;
+        }
+
+        // Lectura: M x = ptr.field(&T::campo)
+        operator M() const {
+            std::vector<char> data = MPointerConnection::client_->getMemoryRange(proxy_id_, offset_, sizeof(M));
+            if (data.size() < sizeof(M)) {
+                throw std::runtime_error("Proxy: Datos insuficientes del servidor");
+            }
+            M result;
+            std::memcpy(&result, data.data(), sizeof(M));
+            return result;
+        }
+
+        AsyncResult<M> getAsync() const {
+            return MPointerConnection::client_->sendRequestAsync<M>(
+                Message::getRangeRequest(proxy_id_, offset_, sizeof(M)), [](const Message& response) {
+                    if (!response.isSuccess() || response.getData().size() < sizeof(M)) {
+                        throw std::runtime_error("Proxy: Datos insuficientes del servidor");
+                    }
+                    M result;
+                    std::memcpy(&result, response.getData().data(), sizeof(M));
+                    return result;
+                });
+        }
+
+        AsyncResult<bool> setAsync(const M& value) const {
+            std::vector<char> data(sizeof(M));
+            std::memcpy(data.data(), &value, sizeof(M));
+            return MPointerConnection::client_->setMemoryRangeAsync(proxy_id_, offset_, data);
+        }
+
+        // Como las de MPointer, sobre el campo
+        bool compareExchange(M& expected, M desired) const requires AtomicInteger<M> {
+            M previous = atomicUpdate(proxy_id_, offset_, AtomicOp::COMPARE_EXCHANGE, desired, expected);
+            bool exchanged = previous == expected;
+            expected = previous;
+            return exchanged;
+        }
+        M fetchAdd(M delta) const requires AtomicInteger<M> {
+            return atomicUpdate(proxy_id_, offset_, AtomicOp::FETCH_ADD, delta);
+        }
+        M exchange(M value) const requires AtomicInteger<M> {
+            return atomicUpdate(proxy_id_, offset_, AtomicOp::EXCHANGE, value);
+        }
+    };
+
+    // Envía un ATOMIC sobre el entero en offset y devuelve su valor anterior
+    template <AtomicInteger V>
+    static V atomicUpdate(int id, size_t offset, AtomicOp op, V value, V expected = V()) {
+        std::vector<char> operand(sizeof(V));
+        std::memcpy(operand.data(), &value, sizeof(V));
+        std::vector<char> compared;
+        if (op == AtomicOp::COMPARE_EXCHANGE) {
+            compared.resize(sizeof(V));
+            std::memcpy(compared.data(), &expected, sizeof(V));
+        }
+        std::vector<char> data = MPointerConnection::client_->atomic(id, offset, op, operand, compared);
+        if (data.size() < sizeof(V)) {
+            throw std::runtime_error("Proxy: Datos insuficientes del servidor");
+        }
+        V previous;
+        std::memcpy(&previous, data.data(), sizeof(V));
+        return previous;
+    }
+
 public:
+    // Conteo de referencias con pesos: el contador de un bloque en el servidor
+    // es el peso total repartido entre quienes lo referencian, y cada MPointer
+    // guarda su parte. Una copia se lleva la mitad del peso del original sin
+    // hablar con el servidor; sólo al destruirse se devuelve el peso (ver
+    // SocketClient::queueRefCountChange) y sólo cuando una parte de peso 1 ya
+    // no se puede dividir se pide peso nuevo. Las referencias nuevas (New,
+    // MPointer(id)) nacen con este peso.
+    static constexpr uint32_t kReferenceWeight = 1u << 16;
+
     // Método para crear un nuevo MPointer
     static MPointer<T> New() {
          // Usar el cliente centralizado
@@ -87,19 +200,34 @@ public:
         }
         // Usar sizeof(T) directamente. Para Node, T es LinkedList<X>::Node,
         // así que el tamaño será correcto (sizeof(Data) + sizeof(int for next_id))
-        int id = MPointerConnection::client_->createMemoryBlock(sizeof(T), typeid(T).name());
-        return MPointer<T>(id);
+        // El nombre del tipo sólo se envía al servidor la primera vez que se
+        // registra en la conexión
+        int id = MPointerConnection::client_->createMemoryBlock(sizeof(T), typeId(), typeid(T).name(),
+                                                                kReferenceWeight);
+        // El peso con el que nace el bloque pasa a ser el de este MPointer;
+        // MPointer(id) pediría más y el bloque nunca se liberaría
+        MPointer<T> created;
+        created.adopt(id, kReferenceWeight);
+        return created;
+    }
+
+    // ID del tipo T en el servidor; se calcula una sola vez por T
+    static uint32_t typeId() {
+        static const uint32_t type_id = typeIdOf(typeid(T).name());
+        return type_id;
     }
 
     // Constructor por defecto
-    MPointer() : id_(-1) {}
+    MPointer() : id_(-1), weight_(0) {}
 
     // Constructor con ID
-    explicit MPointer(int id) : id_(id) {
-        // Incrementar al tomar referencia a un ID existente
+    explicit MPointer(int id) : id_(id), weight_(0) {
+        // Pedir peso al tomar referencia a un ID existente
         if (id_ >= 0) {
             if (MPointerConnection::client_) {
-                 MPointerConnection::client_->increaseRefCount(id_);
+                 if (MPointerConnection::client_->increaseRefCount(id_, kReferenceWeight)) {
+                     weight_ = kReferenceWeight;
+                 }
             } else {
                  // Opcional: Advertir si se crea antes de Init
                  std::cerr << "Advertencia: MPointer(id) creado antes de inicializar la conexión." << std::endl;
@@ -107,12 +235,13 @@ public:
         }
     }
 
-    // Constructor de copia
-    MPointer(const MPointer<T>& other) : id_(other.id_) {
+    // Constructor de copia: se lleva parte del peso de other, normalmente
+    // sin ninguna petición al servidor
+    MPointer(const MPointer<T>& other) : id_(other.id_), weight_(0) {
         if (id_ >= 0) {
              // Usar el cliente centralizado
             if (MPointerConnection::client_) {
-                 MPointerConnection::client_->increaseRefCount(id_);
+                 weight_ = other.splitWeight();
             } else {
                  // Podríamos lanzar excepción o loguear advertencia si se copia antes de Init
                  std::cerr << "Advertencia: MPointer copiado antes de inicializar la conexión." << std::endl;
@@ -120,13 +249,21 @@ public:
         }
     }
 
+    // Constructor de movimiento: se lleva la referencia y su peso tal cual,
+    // sin ir al servidor; other queda nulo
+    MPointer(MPointer<T>&& other) noexcept : id_(other.id_), weight_(other.weight()) {
+        other.release();
+    }
+
     // Destructor
     ~MPointer() {
         if (id_ >= 0) {
             try {
                  // Usar el cliente centralizado
-                 if (MPointerConnection::client_) { // Asegurarse que el cliente existe
-                     MPointerConnection::client_->decreaseRefCount(id_);
+                 uint32_t weight = weight_.load(std::memory_order_relaxed);
+                 if (MPointerConnection::client_ && weight > 0) { // Asegurarse que el cliente existe
+                     // Devolver el peso; se acumula con el de otras copias (ver queueRefCountChange)
+                     MPointerConnection::client_->queueRefCountChange(id_, -static_cast<int64_t>(weight));
                  } // Si no existe (ej. programa termina), no hacer nada
             } catch (const std::exception& e) {
                 // Evitar que excepciones salgan del destructor
@@ -149,16 +286,15 @@ public:
             // Usar el cliente centralizado
             if (MPointerConnection::client_) {
                  int old_id = id_; // Guardar ID antiguo
+                 uint32_t old_weight = weight_.load(std::memory_order_relaxed);
                  id_ = other.id_; // Copiar ID nuevo PRIMERO
                  
-                 // Incrementar referencia del nuevo ID (si es válido)
-                 if (id_ >= 0) {
-                    MPointerConnection::client_->increaseRefCount(id_);
-                 }
+                 // Tomar parte del peso del nuevo ID (si es válido)
+                 weight_ = id_ >= 0 ? other.splitWeight() : 0;
                  
-                 // Decrementar referencia del antiguo ID (si era válido)
-                 if (old_id >= 0) {
-                    MPointerConnection::client_->decreaseRefCount(old_id);
+                 // Devolver el peso del antiguo ID (si era válido)
+                 if (old_id >= 0 && old_weight > 0) {
+                    MPointerConnection::client_->queueRefCountChange(old_id, -static_cast<int64_t>(old_weight));
                  }
             } else {
                 // Comportamiento si Init no se llamó? Copiar ID pero no refs?
@@ -169,6 +305,71 @@ public:
         return *this;
     }
 
+    // Asignación por movimiento: devuelve el peso propio (como el destructor)
+    // y se queda con la referencia de other sin pedir peso nuevo
+    MPointer<T>& operator=(MPointer<T>&& other) noexcept {
+        if (this != std::addressof(other)) {
+            MPointer<T> old(std::move(*this));
+            id_ = other.id_;
+            weight_ = other.weight();
+            other.release();
+        }
+        return *this;
+    }
+
+    // Lectura y escritura sin bloquear (*ptr bloquea): la petición sale ya y
+    // el resultado se recoge con get() o con co_await. Lanzar varias antes de
+    // esperarlas solapa sus idas y vueltas al servidor.
+    AsyncResult<T> getAsync() const {
+        if (id_ < 0) {
+            throw std::runtime_error("Lectura desde un MPointer nulo");
+        }
+        if (!MPointerConnection::client_) {
+            throw std::runtime_error("MPointer no inicializado. Llame a MPointerConnection::Init primero.");
+        }
+        return MPointerConnection::client_->sendRequestAsync<T>(Message::getRequest(id_), [](const Message& response) {
+            if (!response.isSuccess() || response.getData().size() < sizeof(T)) {
+                throw std::runtime_error("Proxy: Datos insuficientes del servidor");
+            }
+            T result;
+            std::memcpy(&result, response.getData().data(), sizeof(T));
+            return result;
+        });
+    }
+
+    AsyncResult<bool> setAsync(const T& value) const {
+        if (id_ < 0) {
+            throw std::runtime_error("Asignación a un MPointer nulo");
+        }
+        if (!MPointerConnection::client_) {
+            throw std::runtime_error("MPointer no inicializado. Llame a MPointerConnection::Init primero.");
+        }
+        std::vector<char> data(sizeof(T));
+        std::memcpy(data.data(), &value, sizeof(T));
+        return MPointerConnection::client_->setMemoryBlockAsync(id_, data);
+    }
+
+    // Actualizaciones atómicas en el servidor, en una sola ida y vuelta y sin
+    // carreras con otros clientes (a diferencia de leer con *ptr y escribir
+    // después). Como en std::atomic, compareExchange escribe desired sólo si
+    // el valor actual es expected y, si no, deja en expected el que encontró.
+    bool compareExchange(T& expected, T desired) const requires AtomicInteger<T> {
+        return fieldAt<T>(0).compareExchange(expected, desired);
+    }
+    T fetchAdd(T delta) const requires AtomicInteger<T> {
+        return fieldAt<T>(0).fetchAdd(delta);
+    }
+    T exchange(T value) const requires AtomicInteger<T> {
+        return fieldAt<T>(0).exchange(value);
+    }
+
+    // Acceso a un solo campo de T sin transferir el resto del bloque, p. ej.
+    // node.field(&Node::next_id) = id
+    template <typename M, typename C> requires std::is_base_of_v<C, T>
+    FieldProxy<M> field(M C::* member) const {
+        return fieldAt<M>(memberOffset<T, M>(member));
+    }
+
     // Operador dirección (&)
     int operator&() const {
         return id_;
@@ -184,9 +385,107 @@ public:
         return id_;
     }
 
+    // Peso que tiene esta referencia: lo que hay que devolver con
+    // DECREASE_REF_COUNT si se suelta por otra vía (p. ej. en un BATCH)
+    uint32_t weight() const {
+        return weight_.load(std::memory_order_relaxed);
+    }
+
     // Libera la "propiedad" de este MPointer sin decrementar la referencia
     void release() {
         id_ = -1;
+        weight_ = 0;
+    }
+
+    // Lo contrario: pasa a apuntar a id con un peso que ya se contó en el
+    // servidor (p. ej. en un BATCH), sin enviar INCREASE_REF_COUNT. La
+    // referencia anterior se suelta como con release().
+    void adopt(int id, uint32_t weight = 1) {
+        id_ = id;
+        weight_ = weight;
+    }
+
+private:
+    friend class MPointerRef<T>;
+
+    template <typename M>
+    FieldProxy<M> fieldAt(size_t offset) const {
+        if (id_ < 0) {
+            throw std::runtime_error("Intento de dereferencia de un MPointer nulo");
+        }
+        if (!MPointerConnection::client_) {
+            throw std::runtime_error("MPointer no inicializado. Llame a MPointerConnection::Init primero.");
+        }
+        return FieldProxy<M>(id_, offset);
+    }
+
+    // Parte del peso para una copia. Se divide a medias con una operación
+    // atómica, porque copiar el mismo MPointer desde varios hilos no lo
+    // modifica a la vista (es const). Con peso 1 no se puede dividir: la copia
+    // recibe peso nuevo del servidor, pedido de forma diferida porque esta
+    // referencia mantiene vivo el bloque mientras tanto. Sin peso (un
+    // MPointer(id) cuyo incremento falló, o uno ya movido) no hay nada que
+    // mantenga vivo el bloque, así que la copia tampoco recibe peso.
+    uint32_t splitWeight() const {
+        uint32_t weight = weight_.load(std::memory_order_relaxed);
+        while (weight > 1) {
+            if (weight_.compare_exchange_weak(weight, weight - weight / 2, std::memory_order_relaxed)) {
+                return weight / 2;
+            }
+        }
+        if (weight == 0) {
+            return 0;
+        }
+        MPointerConnection::client_->queueRefCountChange(id_, kReferenceWeight);
+        return kReferenceWeight;
+    }
+
+    int id_;  // ID del bloque de memoria en el servidor
+    mutable std::atomic<uint32_t> weight_;  // Parte del contador del bloque que es de este MPointer
+};
+
+// Referencia prestada a un bloque: se lee y se escribe como un MPointer, pero
+// no cuenta como referencia, así que crearla, copiarla o destruirla no envía
+// nada al servidor. Sólo es válida mientras algo mantenga vivo el bloque: un
+// MPointer, o un enlace desde otro bloque (como los next_id de LinkedList).
+// Pensada para recorridos, donde cada paso sólo necesita leer el bloque.
+template <typename T>
+class MPointerRef {
+public:
+    MPointerRef() : id_(-1) {}
+    explicit MPointerRef(int id) : id_(id) {}
+    MPointerRef(const MPointer<T>& owner) : id_(owner.getId()) {}
+
+    // Como el operador * de MPointer
+    typename MPointer<T>::Proxy operator*() const {
+        if (id_ < 0) {
+            throw std::runtime_error("Intento de dereferencia de un MPointer nulo");
+        }
+        return typename MPointer<T>::Proxy(id_);
+    }
+
+    // Como MPointer::field
+    template <typename M, typename C> requires std::is_base_of_v<C, T>
+    typename MPointer<T>::template FieldProxy<M> field(M C::* member) const {
+        if (id_ < 0) {
+            throw std::runtime_error("Intento de dereferencia de un MPointer nulo");
+        }
+        if (!MPointerConnection::client_) {
+            throw std::runtime_error("MPointer no inicializado. Llame a MPointerConnection::Init primero.");
+        }
+        return typename MPointer<T>::template FieldProxy<M>(id_, memberOffset<T, M>(member));
+    }
+
+    int operator&() const {
+        return id_;
+    }
+
+    bool isValid() const {
+        return id_ >= 0;
+    }
+
+    int getId() const {
+        return id_;
     }
 
 private:
@@ -7,6 +7,9 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
 #include <Windows.h>
 #include "../mpointer/mpointer.h"
 
@@ -19,7 +22,10 @@ std::atomic<int> SocketClient::instance_count_{0};
 // Definición e inicialización del cliente estático compartido
 std::shared_ptr<SocketClient> MPointerConnection::client_ = nullptr;
 
-SocketClient::SocketClient() : socket_fd_(INVALID_SOCKET), connected_(false), port_(0) {
+// Tiempo máximo de espera de una respuesta; también es el timeout de recv del socket
+constexpr auto kResponseTimeout = std::chrono::seconds(15);
+
+SocketClient::SocketClient() : socket_fd_(INVALID_SOCKET), connected_(false), port_(0), reader_(1024 * 1024) {
     // Incrementar contador y llamar a WSAStartup si es la primera instancia
     if (instance_count_.fetch_add(1) == 0) {
         WSADATA wsaData;
@@ -34,7 +40,18 @@ SocketClient::SocketClient() : socket_fd_(INVALID_SOCKET), connected_(false), po
 }
 
 SocketClient::~SocketClient() {
+    // Los cambios de contador pendientes salen antes de cerrar la conexión
+    stopRefCountFlusher();
     disconnect();
+    // Las corrutinas ya reanudadas terminan antes de destruir el cliente
+    {
+        std::lock_guard<std::mutex> lock(continuation_mutex_);
+        stopping_ = true;
+    }
+    continuation_cv_.notify_all();
+    if (continuation_thread_.joinable()) {
+        continuation_thread_.join();
+    }
     // Decrementar contador y llamar a WSACleanup si es la última instancia
     if (instance_count_.fetch_sub(1) == 1) {
          if (WSACleanup() != 0) {
@@ -51,9 +68,8 @@ bool SocketClient::connect(const std::string& host, int port) {
     host_ = host;
     port_ = port;
 
-    if (connected_) {
-        disconnect();
-    }
+    // Sólo cerrar: disconnect() volvería a tomar socket_mutex_
+    closeConnection();
 
     // Crear el socket
     socket_fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
@@ -87,8 +103,11 @@ bool SocketClient::connect(const std::string& host, int port) {
         socket_fd_ = INVALID_SOCKET;
         return false;
     }
+    setNoDelay(socket_fd_);
 
     connected_ = true;
+    forgetRegisteredTypes();
+    startReader();
     return true;
 }
 
@@ -97,17 +116,49 @@ bool SocketClient::isConnected() const {
 }
 
 void SocketClient::disconnect() {
+    flushRefCountChanges();
     std::lock_guard<std::mutex> lock(socket_mutex_);
+    closeConnection();
+}
 
+void SocketClient::closeConnection() {
     if (socket_fd_ != INVALID_SOCKET) {
+        // shutdown despierta al hilo lector, que falla las peticiones pendientes y termina
         shutdown(socket_fd_, SD_BOTH);
+    }
+    if (reader_thread_.joinable()) {
+        reader_thread_.join();
+    }
+    if (socket_fd_ != INVALID_SOCKET) {
         closesocket(socket_fd_);
         socket_fd_ = INVALID_SOCKET;
     }
     connected_ = false;
 }
 
-bool SocketClient::tryReconnect() {
+void SocketClient::startReader() {
+    reader_.reset();
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        reading_ = true;
+    }
+    generation_++;
+    reader_thread_ = std::thread(&SocketClient::readResponses, this, socket_fd_);
+}
+
+void SocketClient::forgetRegisteredTypes() {
+    // Una conexión nueva puede llegar a un servidor reiniciado que no conoce los tipos
+    std::lock_guard<std::mutex> lock(types_mutex_);
+    registered_types_.clear();
+}
+
+bool SocketClient::tryReconnect(uint64_t seen_generation) {
+    std::lock_guard<std::mutex> lock(socket_mutex_);
+
+    // Otro hilo con peticiones en la misma conexión caída ya ha reconectado
+    if (generation_ != seen_generation && connected_) {
+        return true;
+    }
     if (host_.empty() || port_ == 0) {
         return false;
     }
@@ -115,12 +166,7 @@ bool SocketClient::tryReconnect() {
     std::cerr << "Intentando reconectar al servidor..." << std::endl;
 
     // Cerrar el socket anterior si está abierto
-    if (socket_fd_ != INVALID_SOCKET) {
-        shutdown(socket_fd_, SD_BOTH);
-        closesocket(socket_fd_);
-        socket_fd_ = INVALID_SOCKET;
-    }
-    connected_ = false;
+    closeConnection();
 
     // Intentar reconectar hasta 3 veces
     for (int attempt = 0; attempt < 3; ++attempt) {
@@ -159,8 +205,11 @@ bool SocketClient::tryReconnect() {
             std::this_thread::sleep_for(std::chrono::seconds(1));
             continue;
         }
+        setNoDelay(socket_fd_);
 
         connected_ = true;
+        forgetRegisteredTypes();
+        startReader();
         std::cerr << "Reconexión exitosa" << std::endl;
         return true;
     }
@@ -169,143 +218,193 @@ bool SocketClient::tryReconnect() {
     return false;
 }
 
-bool SocketClient::sendMessage(const Message& message) {
-    if (!connected_) {
-        std::cerr << "No conectado al servidor" << std::endl;
-        return false;
+void SocketClient::submitRequest(const Message& request, ResponseCallback done, uint64_t& generation) {
+    std::unique_lock<std::mutex> lock(socket_mutex_);
+    generation = generation_;
+
+    uint32_t request_id = next_request_id_++;
+    if (request_id == 0) {
+        request_id = next_request_id_++;
     }
 
-    std::vector<char> buffer = message.serialize();
+    // Registrar la petición antes de enviarla: la respuesta puede llegar
+    // al hilo lector antes de que writeBytes vuelva
+    {
+        std::unique_lock<std::mutex> pending_lock(pending_mutex_);
+        if (!connected_ || !reading_) {
+            pending_lock.unlock();
+            lock.unlock();
+            done(nullptr, std::make_exception_ptr(std::runtime_error("No conectado al servidor")));
+            return;
+        }
+        pending_.push_back({request_id, std::move(done), std::chrono::steady_clock::now()});
+    }
 
-    // Enviar longitud del mensaje
-    int length = buffer.size();
-    if (send(socket_fd_, reinterpret_cast<char*>(&length), sizeof(int), 0) != sizeof(int)) {
-        std::cerr << "Error al enviar tamaño del mensaje: " << WSAGetLastError() << std::endl;
-        return false;
+    // El mensaje se codifica directamente detrás de su longitud, y ambos salen
+    // juntos en una sola llamada
+    send_buffer_.clear();
+    size_t frame_start = beginFrame(send_buffer_);
+    request.appendTo(send_buffer_, wire_format_, request_id);
+    endFrame(send_buffer_, frame_start);
+    if (!writeBytes(socket_fd_, send_buffer_.data(), send_buffer_.size())) {
+        // La conexión ya no sirve: el hilo lector fallará esta petición y las demás
+        std::cerr << "Error al enviar el mensaje: " << WSAGetLastError() << std::endl;
+        shutdown(socket_fd_, SD_BOTH);
     }
+}
 
-    // Enviar mensaje
-    int total_sent = 0;
-    while (total_sent < buffer.size()) {
-        int sent = send(socket_fd_, buffer.data() + total_sent,
-                      static_cast<int>(buffer.size() - total_sent), 0);
-        if (sent == SOCKET_ERROR) {
-            int error = WSAGetLastError();
-            if (error == WSAEINTR) continue;  // Interrumpido por señal, volver a intentar
-            std::cerr << "Error al enviar el mensaje: " << error << std::endl;
-            return false;
+std::future<Message> SocketClient::submitRequest(const Message& request, uint64_t& generation) {
+    auto response = std::make_shared<std::promise<Message>>();
+    std::future<Message> result = response->get_future();
+    submitRequest(request, [response](const Message* message, std::exception_ptr error) {
+        if (error) {
+            response->set_exception(error);
+        } else {
+            response->set_value(*message);
         }
-        total_sent += sent;
-    }
+    }, generation);
+    return result;
+}
 
-    return true;
+void SocketClient::resumeLater(std::coroutine_handle<> waiter) {
+    {
+        std::lock_guard<std::mutex> lock(continuation_mutex_);
+        if (!continuation_thread_.joinable()) {
+            continuation_thread_ = std::thread(&SocketClient::runContinuations, this);
+        }
+        continuations_.push_back(waiter);
+    }
+    continuation_cv_.notify_one();
 }
 
-Message SocketClient::receiveMessage() {
-    if (!connected_) {
-        throw std::runtime_error("No conectado al servidor");
+void SocketClient::runContinuations() {
+    std::unique_lock<std::mutex> lock(continuation_mutex_);
+    while (true) {
+        continuation_cv_.wait(lock, [this] { return stopping_ || !continuations_.empty(); });
+        if (continuations_.empty()) {
+            return;
+        }
+        std::coroutine_handle<> waiter = continuations_.front();
+        continuations_.pop_front();
+        lock.unlock();
+        waiter.resume();
+        lock.lock();
     }
+}
 
-    // Recibir longitud del mensaje
-    int length = 0;
-    int bytes_received = recv(socket_fd_, reinterpret_cast<char*>(&length), sizeof(int), 0);
+void SocketClient::readResponses(SOCKET socket) {
+    std::string error;
+    while (error.empty()) {
+        std::span<const char> frame;
+        switch (reader_.next(socket, frame)) {
+            case FrameStatus::OK:
+                break;
+            case FrameStatus::CLOSED:
+                error = "Conexión cerrada por el servidor";
+                continue;
+            case FrameStatus::INVALID:
+                error = "Longitud de mensaje inválida";
+                continue;
+            case FrameStatus::FAILED: {
+                if (WSAGetLastError() == WSAETIMEDOUT) {
+                    // Sin respuestas durante el timeout de recv: sólo es un error
+                    // si la petición más antigua lleva esperando todo ese tiempo
+                    std::lock_guard<std::mutex> lock(pending_mutex_);
+                    if (pending_.empty() ||
+                        std::chrono::steady_clock::now() - pending_.front().sent_at < kResponseTimeout) {
+                        continue;
+                    }
+                    error = "Tiempo de espera agotado al recibir el mensaje";
+                    continue;
+                }
+                error = "Error al recibir el mensaje: " + std::to_string(WSAGetLastError());
+                continue;
+            }
+        }
 
-    if (bytes_received != sizeof(int)) {
-        if (bytes_received == 0) {
-            throw std::runtime_error("Conexión cerrada por el servidor");
-        } else {
-            throw std::runtime_error("Error al recibir tamaño del mensaje: " +
-                                    std::to_string(WSAGetLastError()));
+        MessageView response;
+        try {
+            response = MessageView::decode(frame);
+        } catch (const std::exception& e) {
+            error = std::string("Respuesta inválida del servidor: ") + e.what();
+            continue;
         }
-    }
 
-    if (length <= 0 || length > 1024 * 1024) {  // Limitar tamaño a 1MB
-        throw std::runtime_error("Longitud de mensaje inválida: " + std::to_string(length));
-    }
-
-    // Recibir mensaje
-    std::vector<char> buffer(length);
-    bytes_received = 0;
-    while (bytes_received < length) {
-        int result = recv(socket_fd_, buffer.data() + bytes_received,
-                        static_cast<int>(length - bytes_received), 0);
-        if (result <= 0) {
-            if (result == 0) {
-                throw std::runtime_error("Conexión cerrada por el servidor durante recepción");
-            } else {
-                int error = WSAGetLastError();
-                if (error == WSAEINTR) {
-                    continue;  // Interrumpido por señal, volver a intentar
-                } else {
-                    throw std::runtime_error("Error al recibir el mensaje: " +
-                                          std::to_string(error));
+        // Las respuestas V1 no llevan ID: corresponden a la petición más antigua
+        ResponseCallback waiting;
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex_);
+            auto match = pending_.begin();
+            if (response.getRequestId() != 0) {
+                while (match != pending_.end() && match->request_id != response.getRequestId()) {
+                    ++match;
                 }
             }
+            if (match == pending_.end()) {
+                std::cerr << "Respuesta sin petición pendiente (ID " << response.getRequestId() << ")" << std::endl;
+                continue;
+            }
+            waiting = std::move(match->done);
+            pending_.erase(match);
         }
-        bytes_received += result;
+        Message message = response.toMessage();
+        waiting(&message, nullptr);
     }
 
-    return Message::deserialize(buffer);
+    connected_ = false;
+    failPending(error);
+}
+
+void SocketClient::failPending(const std::string& error) {
+    std::deque<PendingRequest> failed;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        reading_ = false;
+        failed.swap(pending_);
+    }
+    std::exception_ptr exception = std::make_exception_ptr(std::runtime_error(error));
+    for (PendingRequest& request : failed) {
+        request.done(nullptr, exception);
+    }
 }
 
 Message SocketClient::sendRequest(const Message& request) {
-    bool reconnection_needed = false;
-    
-    // Primer intento con el mutex bloqueado
+    uint64_t generation = 0;
+    try {
+        return submitRequest(request, generation).get();
+    } catch (const std::exception&) {
+        // Reintentar una vez por una conexión nueva
+    }
+
+    if (!tryReconnect(generation)) {
+        throw std::runtime_error("Error al enviar solicitud: no se pudo reconectar");
+    }
+
+    try {
+        return submitRequest(request, generation).get();
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Error al recibir respuesta: ") + e.what());
+    }
+}
+
+void SocketClient::registerType(uint32_t type_id, const char* type_name) {
     {
-        std::lock_guard<std::mutex> lock(socket_mutex_);
-        
-        if (!connected_) {
-            reconnection_needed = true;
-        } else {
-            // Intentar enviar el mensaje
-            bool sent = false;
-            try {
-                sent = sendMessage(request);
-                if (sent) {
-                    // Si el envío fue exitoso, intentar recibir la respuesta
-                    try {
-                        return receiveMessage();
-                    } catch (const std::exception& e) {
-                        reconnection_needed = true;
-                    }
-                } else {
-                    reconnection_needed = true;
-                }
-            } catch (const std::exception&) {
-                reconnection_needed = true;
-            }
+        std::lock_guard<std::mutex> lock(types_mutex_);
+        if (registered_types_.count(type_id)) {
+            return;
         }
     }
-    
-    // Si se necesita reconexión, hacerlo fuera del bloque del mutex
-    if (reconnection_needed) {
-        if (!tryReconnect()) {
-            throw std::runtime_error("Error al enviar solicitud: no se pudo reconectar");
-        }
-        
-        // Volver a intentar con el mutex bloqueado después de la reconexión
-        std::lock_guard<std::mutex> lock(socket_mutex_);
-        
-        if (!sendMessage(request)) {
-            throw std::runtime_error("Error al enviar solicitud después de reconectar");
-        }
-        
-        try {
-            return receiveMessage();
-        } catch (const std::exception& e) {
-            throw std::runtime_error(std::string("Error al recibir respuesta: ") + e.what());
-        }
+
+    Message response = sendRequest(Message::registerTypeRequest(type_id, type_name));
+    if (!response.isSuccess()) {
+        throw std::runtime_error(std::string("Error al registrar el tipo ") + type_name);
     }
-    
-    // Este punto nunca debería alcanzarse, pero por si acaso lanzamos una excepción
-    throw std::runtime_error("Error inesperado en la comunicación con el servidor");
-}
 
-int SocketClient::createMemoryBlock(size_t size, const std::string& type) {
-    Message request = Message::createRequest(size, type);
-    Message response = sendRequest(request);
+    std::lock_guard<std::mutex> lock(types_mutex_);
+    registered_types_.insert(type_id);
+}
 
+int SocketClient::createdBlockId(const Message& response) {
     if (!response.isSuccess()) {
         throw std::runtime_error("Error al crear bloque de memoria");
     }
@@ -320,6 +419,32 @@ int SocketClient::createMemoryBlock(size_t size, const std::string& type) {
     return id;
 }
 
+std::vector<char> SocketClient::blockData(const Message& response) {
+    if (!response.isSuccess()) {
+        throw std::runtime_error("Error al obtener datos del bloque de memoria");
+    }
+
+    return response.getData();
+}
+
+SocketClient::ChasedBlock SocketClient::chasedBlock(const Message& response) {
+    if (!response.isSuccess() || response.getData().size() < sizeof(int)) {
+        throw std::runtime_error("Error al recorrer la cadena de bloques");
+    }
+
+    ChasedBlock block;
+    std::memcpy(&block.id, response.getData().data(), sizeof(int));
+    block.data.assign(response.getData().begin() + sizeof(int), response.getData().end());
+    return block;
+}
+
+int SocketClient::createMemoryBlock(size_t size, uint32_t type_id, const char* type_name, uint32_t weight) {
+    registerType(type_id, type_name);
+
+    Message request = Message::createRequest(size, type_id, weight);
+    return createdBlockId(sendRequest(request));
+}
+
 bool SocketClient::setMemoryBlock(int id, const std::vector<char>& data) {
     Message request = Message::setRequest(id, data);
     Message response = sendRequest(request);
@@ -328,23 +453,331 @@ bool SocketClient::setMemoryBlock(int id, const std::vector<char>& data) {
 
 std::vector<char> SocketClient::getMemoryBlock(int id) {
     Message request = Message::getRequest(id);
+    return blockData(sendRequest(request));
+}
+
+bool SocketClient::setMemoryRange(int id, size_t offset, const std::vector<char>& data) {
+    Message request = Message::setRangeRequest(id, offset, data);
     Message response = sendRequest(request);
+    return response.isSuccess();
+}
 
-    if (!response.isSuccess()) {
-        throw std::runtime_error("Error al obtener datos del bloque de memoria");
-    }
+std::vector<char> SocketClient::getMemoryRange(int id, size_t offset, uint32_t length) {
+    Message request = Message::getRangeRequest(id, offset, length);
+    return blockData(sendRequest(request));
+}
 
-    return response.getData();
+std::vector<char> SocketClient::atomic(int id, size_t offset, AtomicOp op, const std::vector<char>& value,
+                                       const std::vector<char>& expected) {
+    Message request = Message::atomicRequest(id, offset, op, value, expected);
+    return blockData(sendRequest(request));
 }
 
-bool SocketClient::increaseRefCount(int id) {
-    Message request = Message::refCountRequest(id, true);
+bool SocketClient::increaseRefCount(int id, uint32_t amount) {
+    Message request = Message::refCountRequest(id, true, amount);
     Message response = sendRequest(request);
     return response.isSuccess();
 }
 
-bool SocketClient::decreaseRefCount(int id) {
-    Message request = Message::refCountRequest(id, false);
+bool SocketClient::decreaseRefCount(int id, uint32_t amount) {
+    // Los incrementos diferidos tienen que llegar antes que este decremento
+    flushRefCountChanges();
+    Message request = Message::refCountRequest(id, false, amount);
     Message response = sendRequest(request);
     return response.isSuccess();
-}
\ No newline at end of file
+}
+
+void SocketClient::queueRefCountChange(int id, int64_t delta) {
+    {
+        std::lock_guard<std::mutex> lock(ref_mutex_);
+        bool deferred = ref_flush_interval_.count() > 0 && !ref_stopping_;
+        if (deferred && !ref_flush_thread_.joinable()) {
+            ref_flush_thread_ = std::thread(&SocketClient::runRefCountFlusher, this);
+        }
+        int64_t& pending = ref_deltas_[id];
+        pending += delta;
+        if (pending == 0) {
+            ref_deltas_.erase(id);  // Se anularon: no hay nada que enviar
+        } else if (deferred && (ref_deltas_.size() == 1 || ref_deltas_.size() >= ref_flush_threshold_)) {
+            ref_cv_.notify_one();
+        }
+        if (deferred) {
+            return;
+        }
+    }
+    // Sin diferir, como increaseRefCount / decreaseRefCount: se envía ya,
+    // junto con lo que quedara pendiente, y se espera la respuesta
+    sendRefCountChanges(true);
+}
+
+void SocketClient::flushRefCountChanges() {
+    sendRefCountChanges(false);
+}
+
+void SocketClient::sendRefCountChanges(bool wait) {
+    std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+    std::unordered_map<int, int64_t> deltas;
+    {
+        std::lock_guard<std::mutex> lock(ref_mutex_);
+        deltas.swap(ref_deltas_);
+        // El peso de un incremento rechazado nunca se contó en el servidor:
+        // devolverlo liberaría el bloque mientras otros aún lo referencian
+        for (auto& [id, delta] : deltas) {
+            auto rejected = ref_rejected_.find(id);
+            if (delta < 0 && rejected != ref_rejected_.end()) {
+                int64_t absorbed = std::min(-delta, rejected->second);
+                delta += absorbed;
+                if ((rejected->second -= absorbed) == 0) {
+                    ref_rejected_.erase(rejected);
+                }
+            }
+        }
+    }
+
+    // Cada operación lleva su cantidad en un uint32_t y el servidor no
+    // acepta más de INT32_MAX de una vez, así que un delta mayor se parte
+    std::vector<Message> operations;
+    std::vector<std::pair<int, uint32_t>> increases;    // Por operación: ID y peso pedido, 0 si es un decremento
+    bool any_increase = false;
+    for (const auto& [id, delta] : deltas) {
+        uint64_t remaining = delta > 0 ? static_cast<uint64_t>(delta) : 0 - static_cast<uint64_t>(delta);
+        while (remaining > 0) {
+            uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(remaining, std::numeric_limits<int32_t>::max()));
+            operations.push_back(Message::refCountRequest(id, delta > 0, count));
+            increases.emplace_back(id, delta > 0 ? count : 0);
+            any_increase |= delta > 0;
+            remaining -= count;
+        }
+    }
+    if (operations.empty()) {
+        return;
+    }
+    Message request = operations.size() == 1 ? operations.front() : Message::batchRequest(operations, wire_format_);
+
+    // Los decrementos sólo se envían: si la conexión se cayó, se pierden con
+    // ella, igual que los bloques del servidor si se reinició
+    uint64_t generation;
+    if (!wait && !any_increase) {
+        submitRequest(request, [](const Message*, std::exception_ptr) {}, generation);
+        return;
+    }
+
+    // Un incremento rechazado (el contador no cabe en 32 bits, o el bloque ya
+    // no existe) hay que apuntarlo antes de que salga ningún decremento
+    // posterior, que espera a flush_mutex_
+    std::vector<Message> responses;
+    try {
+        Message response = submitRequest(request, generation).get();
+        if (operations.size() == 1) {
+            responses.push_back(response);
+        } else if (response.isSuccess()) {
+            responses = Message::batchResponses(response);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Cambios de contador perdidos: " << e.what() << std::endl;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(ref_mutex_);
+    for (size_t i = 0; i < increases.size(); ++i) {
+        const auto& [id, count] = increases[i];
+        if (count > 0 && (i >= responses.size() || !responses[i].isSuccess())) {
+            std::cerr << "El servidor rechazó " << count << " de peso para el bloque " << id << std::endl;
+            ref_rejected_[id] += count;
+        }
+    }
+}
+
+void SocketClient::setRefCountFlush(std::chrono::milliseconds interval, size_t threshold) {
+    {
+        std::lock_guard<std::mutex> lock(ref_mutex_);
+        ref_flush_interval_ = interval;
+        ref_flush_threshold_ = std::max<size_t>(1, threshold);
+    }
+    ref_cv_.notify_all();
+    if (interval.count() <= 0) {
+        flushRefCountChanges();
+    }
+}
+
+void SocketClient::runRefCountFlusher() {
+    std::unique_lock<std::mutex> lock(ref_mutex_);
+    while (true) {
+        ref_cv_.wait(lock, [this] { return ref_stopping_ || !ref_deltas_.empty(); });
+        if (ref_stopping_) {
+            return;
+        }
+        // El primer cambio pendiente espera como mucho un intervalo
+        ref_cv_.wait_for(lock, ref_flush_interval_, [this] {
+            return ref_stopping_ || ref_deltas_.size() >= ref_flush_threshold_;
+        });
+        lock.unlock();
+        flushRefCountChanges();
+        lock.lock();
+    }
+}
+
+void SocketClient::stopRefCountFlusher() {
+    {
+        std::lock_guard<std::mutex> lock(ref_mutex_);
+        ref_stopping_ = true;
+    }
+    ref_cv_.notify_all();
+    if (ref_flush_thread_.joinable()) {
+        ref_flush_thread_.join();
+    }
+}
+
+SocketClient::ChasedBlock SocketClient::chase(int id, size_t next_offset, uint32_t hops) {
+    return chasedBlock(sendRequest(Message::chaseRequest(id, next_offset, hops)));
+}
+
+AsyncResult<Message> SocketClient::sendRequestAsync(const Message& request) {
+    return sendRequestAsync<Message>(request, [](const Message& response) { return response; });
+}
+
+void SocketClient::registerTypePipelined(uint32_t type_id, const char* type_name) {
+    {
+        std::lock_guard<std::mutex> lock(types_mutex_);
+        if (registered_types_.count(type_id)) {
+            return;
+        }
+    }
+
+    // El servidor procesa las peticiones de la conexión en orden: el registro
+    // puede ir justo delante de la que lo necesita sin esperar su respuesta
+    uint64_t generation;
+    submitRequest(Message::registerTypeRequest(type_id, type_name),
+                  [this, type_id](const Message* response, std::exception_ptr error) {
+        if (!error && response->isSuccess()) {
+            std::lock_guard<std::mutex> lock(types_mutex_);
+            registered_types_.insert(type_id);
+        }
+    }, generation);
+}
+
+AsyncResult<int> SocketClient::createMemoryBlockAsync(size_t size, uint32_t type_id, const char* type_name,
+                                                      uint32_t weight) {
+    registerTypePipelined(type_id, type_name);
+    return sendRequestAsync<int>(Message::createRequest(size, type_id, weight), createdBlockId);
+}
+
+AsyncResult<bool> SocketClient::setMemoryBlockAsync(int id, const std::vector<char>& data) {
+    return sendRequestAsync<bool>(Message::setRequest(id, data), [](const Message& response) { return response.isSuccess(); });
+}
+
+AsyncResult<std::vector<char>> SocketClient::getMemoryBlockAsync(int id) {
+    return sendRequestAsync<std::vector<char>>(Message::getRequest(id), blockData);
+}
+
+AsyncResult<bool> SocketClient::setMemoryRangeAsync(int id, size_t offset, const std::vector<char>& data) {
+    return sendRequestAsync<bool>(Message::setRangeRequest(id, offset, data), [](const Message& response) { return response.isSuccess(); });
+}
+
+AsyncResult<std::vector<char>> SocketClient::getMemoryRangeAsync(int id, size_t offset, uint32_t length) {
+    return sendRequestAsync<std::vector<char>>(Message::getRangeRequest(id, offset, length), blockData);
+}
+
+AsyncResult<std::vector<char>> SocketClient::atomicAsync(int id, size_t offset, AtomicOp op,
+                                                         const std::vector<char>& value,
+                                                         const std::vector<char>& expected) {
+    return sendRequestAsync<std::vector<char>>(Message::atomicRequest(id, offset, op, value, expected), blockData);
+}
+
+AsyncResult<bool> SocketClient::increaseRefCountAsync(int id, uint32_t amount) {
+    return sendRequestAsync<bool>(Message::refCountRequest(id, true, amount), [](const Message& response) { return response.isSuccess(); });
+}
+
+AsyncResult<bool> SocketClient::decreaseRefCountAsync(int id, uint32_t amount) {
+    flushRefCountChanges();
+    return sendRequestAsync<bool>(Message::refCountRequest(id, false, amount), [](const Message& response) { return response.isSuccess(); });
+}
+
+AsyncResult<SocketClient::ChasedBlock> SocketClient::chaseAsync(int id, size_t next_offset, uint32_t hops) {
+    return sendRequestAsync<ChasedBlock>(Message::chaseRequest(id, next_offset, hops), chasedBlock);
+}
+
+int SocketClient::Batch::add(const Message& operation) {
+    operations_.push_back(operation);
+    return Message::batchRef(operations_.size() - 1);
+}
+
+int SocketClient::Batch::create(size_t size, uint32_t type_id, const char* type_name, uint32_t weight) {
+    types_.emplace_back(type_id, type_name);
+    return add(Message::createRequest(size, type_id, weight));
+}
+
+int SocketClient::Batch::set(int id, const std::vector<char>& data) {
+    return add(Message::setRequest(id, data));
+}
+
+int SocketClient::Batch::get(int id) {
+    return add(Message::getRequest(id));
+}
+
+int SocketClient::Batch::setRange(int id, size_t offset, const std::vector<char>& data) {
+    return add(Message::setRangeRequest(id, offset, data));
+}
+
+int SocketClient::Batch::getRange(int id, size_t offset, uint32_t length) {
+    return add(Message::getRangeRequest(id, offset, length));
+}
+
+int SocketClient::Batch::link(int id, size_t offset, int target) {
+    return add(Message::linkRequest(id, offset, target));
+}
+
+int SocketClient::Batch::increaseRefCount(int id, uint32_t amount) {
+    return add(Message::refCountRequest(id, true, amount));
+}
+
+int SocketClient::Batch::decreaseRefCount(int id, uint32_t amount) {
+    releases_ = true;
+    return add(Message::refCountRequest(id, false, amount));
+}
+
+int SocketClient::Batch::chase(int id, size_t next_offset, uint32_t hops) {
+    return add(Message::chaseRequest(id, next_offset, hops));
+}
+
+int SocketClient::Batch::atomic(int id, size_t offset, AtomicOp op, const std::vector<char>& value,
+                                const std::vector<char>& expected) {
+    return add(Message::atomicRequest(id, offset, op, value, expected));
+}
+
+std::vector<Message> SocketClient::execute(const Batch& batch) {
+    if (batch.operations_.empty()) {
+        return {};
+    }
+    if (batch.releases_) {
+        flushRefCountChanges();
+    }
+    for (const auto& type : batch.types_) {
+        registerTypePipelined(type.first, type.second.c_str());
+    }
+
+    Message response = sendRequest(Message::batchRequest(batch.operations_, wire_format_));
+    std::vector<Message> responses = Message::batchResponses(response);
+    if (!response.isSuccess() || responses.size() != batch.operations_.size()) {
+        throw std::runtime_error("Error al ejecutar el lote de operaciones");
+    }
+    return responses;
+}
+
+AsyncResult<std::vector<Message>> SocketClient::executeAsync(const Batch& batch) {
+    if (batch.releases_) {
+        flushRefCountChanges();
+    }
+    for (const auto& type : batch.types_) {
+        registerTypePipelined(type.first, type.second.c_str());
+    }
+
+    size_t count = batch.operations_.size();
+    return sendRequestAsync<std::vector<Message>>(Message::batchRequest(batch.operations_, wire_format_),
+                                                  [count](const Message& response) {
+        std::vector<Message> responses = Message::batchResponses(response);
+        if (!response.isSuccess() || responses.size() != count) {
+            throw std::runtime_error("Error al ejecutar el lote de operaciones");
+        }
+        return responses;
+    });
+}
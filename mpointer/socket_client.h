@@ -12,10 +12,21 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <stdexcept> // Para stdexcept
 #include <iostream> // Para cout/cerr
 
 #include "../protocol/message.h"
+#include "../protocol/frame_io.h"
+#include "async_result.h"
 
 #pragma comment(lib, "Ws2_32.lib")
 
@@ -27,28 +38,219 @@ public:
     bool connect(const std::string& host, int port);
     bool isConnected() const;
     void disconnect();
+    // Se puede llamar desde varios hilos a la vez: cada uno envía su petición
+    // sin esperar a las de los demás y un hilo lector reparte las respuestas
     Message sendRequest(const Message& request);
 
+    // Formato de las peticiones (V2 por defecto); el servidor responde en el mismo
+    void setWireFormat(WireFormat format) { wire_format_ = format; }
+
     // Métodos específicos para el Memory Manager
-    int createMemoryBlock(size_t size, const std::string& type);
+    // type_id es el hash del nombre del tipo (typeIdOf); el nombre sólo viaja
+    // la primera vez que se usa el tipo en esta conexión
+    // weight: referencias (peso) con las que nace el bloque, ver MPointer
+    int createMemoryBlock(size_t size, uint32_t type_id, const char* type_name, uint32_t weight = 1);
     bool setMemoryBlock(int id, const std::vector<char>& data);
     std::vector<char> getMemoryBlock(int id);
-    bool increaseRefCount(int id);
-    bool decreaseRefCount(int id);
+    // Sólo una parte del bloque, p. ej. un campo de un struct
+    bool setMemoryRange(int id, size_t offset, const std::vector<char>& data);
+    std::vector<char> getMemoryRange(int id, size_t offset, uint32_t length);
+    // amount: peso que se añade o se devuelve de una vez
+    bool increaseRefCount(int id, uint32_t amount = 1);
+    bool decreaseRefCount(int id, uint32_t amount = 1);
+
+    // Cambios de contador diferidos: en lugar de una ida y vuelta por cada
+    // INCREASE/DECREASE_REF_COUNT, se acumula el cambio neto de cada ID y se
+    // envía sin esperar la respuesta, todo en un BATCH, como mucho interval
+    // después del primer cambio pendiente o en cuanto threshold IDs tienen
+    // cambios. Lo que se pide y se devuelve del mismo ID en ese tiempo se
+    // anula sin llegar al servidor. MPointer envía así el peso que devuelve
+    // al destruirse y el que pide una copia que ya no puede dividir el suyo.
+    // Sólo vale para referencias que ya cuenta en el servidor otra que este
+    // cliente mantiene viva (copias de un MPointer): la primera referencia a
+    // un ID recibido de fuera tiene que pedirse con increaseRefCount. Si el
+    // servidor rechaza un incremento, ese peso no se le devuelve después:
+    // los decrementos del mismo ID lo descuentan antes de enviarse.
+    void queueRefCountChange(int id, int64_t delta);
+    // Envía ya lo acumulado; sólo espera la respuesta si hay incrementos
+    void flushRefCountChanges();
+    // interval acota cuánto se retrasa cualquier cambio, también los
+    // decrementos; interval = 0 vuelve a enviar cada cambio al momento
+    void setRefCountFlush(std::chrono::milliseconds interval, size_t threshold);
+
+    // Bloque al que llega chase: su ID y su contenido
+    struct ChasedBlock {
+        int id;
+        std::vector<char> data;
+    };
+
+    // Sigue en el servidor una cadena de bloques que guardan el ID del
+    // siguiente en next_offset, hops saltos desde id, en una sola ida y vuelta
+    // y sin tocar los contadores de referencias
+    ChasedBlock chase(int id, size_t next_offset, uint32_t hops);
+
+    // Operación atómica sobre el entero de 4 u 8 bytes (value.size()) que
+    // empieza en offset (ver Message::atomicRequest); devuelve su valor anterior
+    std::vector<char> atomic(int id, size_t offset, AtomicOp op, const std::vector<char>& value,
+                             const std::vector<char>& expected = {});
+
+    // Versiones asíncronas: envían la petición y vuelven sin esperar la
+    // respuesta, que se recoge con get() o con co_await (ver async_result.h).
+    // A diferencia de las síncronas no reconectan: si la conexión se cae, el
+    // resultado lleva la excepción.
+    AsyncResult<Message> sendRequestAsync(const Message& request);
+    // convert obtiene el resultado a partir de la respuesta; lo que lance
+    // llega como excepción al que espera
+    template <typename T, typename Convert>
+    AsyncResult<T> sendRequestAsync(const Message& request, Convert convert);
+
+    // Varias operaciones que viajan y se ejecutan juntas, en un solo BATCH y
+    // una sola ida y vuelta. Cada método devuelve una referencia a su
+    // operación (Message::batchRef) que las siguientes pueden usar como ID.
+    class Batch {
+    public:
+        int create(size_t size, uint32_t type_id, const char* type_name, uint32_t weight = 1);
+        int set(int id, const std::vector<char>& data);
+        int get(int id);
+        int setRange(int id, size_t offset, const std::vector<char>& data);
+        int getRange(int id, size_t offset, uint32_t length);
+        int link(int id, size_t offset, int target);    // Escribe el ID target en id, en offset
+        int chase(int id, size_t next_offset, uint32_t hops);
+        int atomic(int id, size_t offset, AtomicOp op, const std::vector<char>& value,
+                   const std::vector<char>& expected = {});
+        int increaseRefCount(int id, uint32_t amount = 1);
+        int decreaseRefCount(int id, uint32_t amount = 1);
+
+        size_t size() const { return operations_.size(); }
+
+    private:
+        friend class SocketClient;
+        int add(const Message& operation);
+
+        std::vector<Message> operations_;
+        std::vector<std::pair<uint32_t, std::string>> types_;      // Tipos usados por los CREATE
+        bool releases_ = false;     // Lleva algún DECREASE_REF_COUNT
+    };
+
+    // Devuelven una respuesta por operación, en el mismo orden
+    std::vector<Message> execute(const Batch& batch);
+    AsyncResult<std::vector<Message>> executeAsync(const Batch& batch);
+
+    // Interpretan la respuesta de un CREATE, un GET o un CHASE; lanzan si falló
+    static int createdBlockId(const Message& response);
+    static std::vector<char> blockData(const Message& response);
+    static ChasedBlock chasedBlock(const Message& response);
+    AsyncResult<int> createMemoryBlockAsync(size_t size, uint32_t type_id, const char* type_name, uint32_t weight = 1);
+    AsyncResult<bool> setMemoryBlockAsync(int id, const std::vector<char>& data);
+    AsyncResult<std::vector<char>> getMemoryBlockAsync(int id);
+    AsyncResult<bool> setMemoryRangeAsync(int id, size_t offset, const std::vector<char>& data);
+    AsyncResult<std::vector<char>> getMemoryRangeAsync(int id, size_t offset, uint32_t length);
+    AsyncResult<bool> increaseRefCountAsync(int id, uint32_t amount = 1);
+    AsyncResult<bool> decreaseRefCountAsync(int id, uint32_t amount = 1);
+    AsyncResult<ChasedBlock> chaseAsync(int id, size_t next_offset, uint32_t hops);
+    AsyncResult<std::vector<char>> atomicAsync(int id, size_t offset, AtomicOp op, const std::vector<char>& value,
+                                               const std::vector<char>& expected = {});
 
 private:
-    bool tryReconnect();
-    bool sendMessage(const Message& message);
-    Message receiveMessage();
+    // Recibe la respuesta o, si no llegó, el error; se llama en el hilo lector
+    using ResponseCallback = std::function<void(const Message* response, std::exception_ptr error)>;
+
+    // Petición enviada que espera su respuesta
+    struct PendingRequest {
+        uint32_t request_id;
+        ResponseCallback done;
+        std::chrono::steady_clock::time_point sent_at;
+    };
+
+    bool tryReconnect(uint64_t seen_generation);
+    void registerType(uint32_t type_id, const char* type_name);
+    void forgetRegisteredTypes();
+    void submitRequest(const Message& request, ResponseCallback done, uint64_t& generation);
+    std::future<Message> submitRequest(const Message& request, uint64_t& generation);
+    void startReader();
+    void readResponses(SOCKET socket);
+    void failPending(const std::string& error);
+    void closeConnection();     // Con socket_mutex_ tomado
+    void resumeLater(std::coroutine_handle<> waiter);
+    void runContinuations();
+    // Registra el tipo justo delante de las peticiones que siguen, sin esperar la respuesta
+    void registerTypePipelined(uint32_t type_id, const char* type_name);
+    void sendRefCountChanges(bool wait);
+    void runRefCountFlusher();
+    void stopRefCountFlusher();
 
     SOCKET socket_fd_;
     std::string host_;
     int port_;
     std::atomic<bool> connected_;
-    std::mutex socket_mutex_; // Para proteger acceso multihilo al socket
+    std::mutex socket_mutex_; // Protege el socket y el envío de peticiones
+    std::vector<char> send_buffer_;   // Se reutiliza en cada petición
+    std::atomic<WireFormat> wire_format_{WireFormat::V2};
+    uint32_t next_request_id_ = 1;    // Nunca 0, que significa "sin ID"
+    std::atomic<uint64_t> generation_{0};   // Conexiones abiertas hasta ahora
+
+    // Hilo lector: es el único que lee del socket mientras la conexión está abierta
+    std::thread reader_thread_;
+    FrameReader reader_;      // Respuestas leídas del socket y aún no entregadas
+
+    // Peticiones en vuelo, en el orden en que se enviaron. El servidor responde
+    // en ese mismo orden, así que normalmente la respuesta es la primera
+    std::mutex pending_mutex_;
+    std::deque<PendingRequest> pending_;
+    bool reading_ = false;    // El hilo lector sigue vivo y acepta peticiones
+
+    // Corrutinas listas para continuar. Se reanudan en un hilo propio para
+    // que el hilo lector nunca ejecute código de la aplicación
+    std::thread continuation_thread_;
+    std::mutex continuation_mutex_;
+    std::condition_variable continuation_cv_;
+    std::deque<std::coroutine_handle<>> continuations_;
+    bool stopping_ = false;
+
+    // Cambios de contador pendientes por ID (ver queueRefCountChange) y el
+    // hilo que los envía. flush_mutex_ se mantiene mientras se envían, para
+    // que un decremento explícito nunca adelante a incrementos ya sacados de
+    // la tabla pero aún no enviados. Los deltas son de 64 bits porque miles
+    // de copias de un mismo ID en un intervalo desbordarían un int.
+    // ref_rejected_ guarda el peso de incrementos que el servidor no contó
+    std::thread ref_flush_thread_;
+    std::mutex ref_mutex_;
+    std::condition_variable ref_cv_;
+    std::unordered_map<int, int64_t> ref_deltas_;
+    std::unordered_map<int, int64_t> ref_rejected_;
+    std::chrono::milliseconds ref_flush_interval_{20};
+    size_t ref_flush_threshold_ = 256;
+    bool ref_stopping_ = false;
+    std::mutex flush_mutex_;
+
+    // Tipos ya registrados en el servidor durante esta conexión
+    std::unordered_set<uint32_t> registered_types_;
+    std::mutex types_mutex_;
 
     // Contador estático para gestionar Winsock
     static std::atomic<int> instance_count_;
 };
 
+template <typename T, typename Convert>
+AsyncResult<T> SocketClient::sendRequestAsync(const Message& request, Convert convert) {
+    auto promise = std::make_shared<std::promise<T>>();
+    auto state = std::make_shared<typename AsyncResult<T>::State>(
+        [this](std::coroutine_handle<> waiter) { resumeLater(waiter); });
+    AsyncResult<T> result(promise->get_future(), state);
+
+    uint64_t generation;
+    submitRequest(request, [promise, state, convert](const Message* response, std::exception_ptr error) {
+        try {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            promise->set_value(convert(*response));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+        state->complete();
+    }, generation);
+    return result;
+}
+
 #endif //SOCKET_CLIENT_H
\ No newline at end of file
@@ -0,0 +1,210 @@
+// frame_io.cpp
+#include "frame_io.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+namespace {
+
+constexpr size_t kMaxSlices = 64;           // Buffers por llamada; muy por debajo de IOV_MAX
+constexpr size_t kReadSize = 16 * 1024;     // Espacio libre mínimo para cada recv
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;    // Un cliente desconectado no debe matar al proceso con SIGPIPE
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+struct Slice {
+    const char* data;
+    size_t size;
+};
+
+bool interrupted() {
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEINTR;
+#else
+    return errno == EINTR;
+#endif
+}
+
+// Envía todos los trozos en orden, tantos como quepan en cada llamada
+bool sendSlices(FrameSocket socket, std::vector<Slice>& slices) {
+    size_t first = 0;
+    while (first < slices.size()) {
+        size_t count = std::min(slices.size() - first, kMaxSlices);
+#ifdef _WIN32
+        WSABUF buffers[kMaxSlices];
+        for (size_t i = 0; i < count; i++) {
+            buffers[i].buf = const_cast<char*>(slices[first + i].data);
+            buffers[i].len = static_cast<ULONG>(slices[first + i].size);
+        }
+        DWORD sent = 0;
+        if (WSASend(socket, buffers, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+            if (interrupted()) {
+                continue;
+            }
+            return false;
+        }
+#else
+        iovec buffers[kMaxSlices];
+        for (size_t i = 0; i < count; i++) {
+            buffers[i].iov_base = const_cast<char*>(slices[first + i].data);
+            buffers[i].iov_len = slices[first + i].size;
+        }
+        msghdr header{};
+        header.msg_iov = buffers;
+        header.msg_iovlen = count;
+        ssize_t sent = sendmsg(socket, &header, kSendFlags);
+        if (sent < 0) {
+            if (interrupted()) {
+                continue;
+            }
+            return false;
+        }
+#endif
+        // Avanzar lo enviado; un envío parcial deja a medias el primer trozo pendiente
+        size_t left = static_cast<size_t>(sent);
+        while (first < slices.size() && left >= slices[first].size) {
+            left -= slices[first].size;
+            first++;
+        }
+        if (left > 0) {
+            slices[first].data += left;
+            slices[first].size -= left;
+        }
+    }
+    return true;
+}
+
+}
+
+bool setNoDelay(FrameSocket socket) {
+#ifdef _WIN32
+    BOOL enable = TRUE;
+#else
+    int enable = 1;
+#endif
+    return setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enable), sizeof(enable)) == 0;
+}
+
+bool writeFrame(FrameSocket socket, const std::vector<char>& payload) {
+    int length = static_cast<int>(payload.size());
+    std::vector<Slice> slices = {{reinterpret_cast<const char*>(&length), sizeof(int)},
+                                 {payload.data(), payload.size()}};
+    return sendSlices(socket, slices);
+}
+
+bool writeFrames(FrameSocket socket, const std::vector<std::vector<char>>& payloads) {
+    std::vector<int> lengths(payloads.size());
+    std::vector<Slice> slices;
+    slices.reserve(2 * payloads.size());
+    for (size_t i = 0; i < payloads.size(); i++) {
+        lengths[i] = static_cast<int>(payloads[i].size());
+        slices.push_back({reinterpret_cast<const char*>(&lengths[i]), sizeof(int)});
+        slices.push_back({payloads[i].data(), payloads[i].size()});
+    }
+    return sendSlices(socket, slices);
+}
+
+size_t beginFrame(std::vector<char>& out) {
+    size_t frame_start = out.size();
+    out.resize(frame_start + sizeof(int));
+    return frame_start;
+}
+
+void endFrame(std::vector<char>& out, size_t frame_start) {
+    int length = static_cast<int>(out.size() - frame_start - sizeof(int));
+    std::memcpy(out.data() + frame_start, &length, sizeof(int));
+}
+
+bool writeBytes(FrameSocket socket, const char* data, size_t size) {
+    std::vector<Slice> slices = {{data, size}};
+    return sendSlices(socket, slices);
+}
+
+FrameReader::FrameReader(size_t max_frame) : max_frame_(max_frame) {
+}
+
+void FrameReader::reset() {
+    begin_ = end_ = 0;
+}
+
+bool FrameReader::hasFrame() const {
+    size_t available = end_ - begin_;
+    if (available < sizeof(int)) {
+        return false;
+    }
+    int length;
+    std::memcpy(&length, buffer_.data() + begin_, sizeof(int));
+    // Un frame inválido también cuenta: next lo detecta sin bloquear
+    return length < 0 || (max_frame_ != 0 && static_cast<size_t>(length) > max_frame_) ||
+           available - sizeof(int) >= static_cast<size_t>(length);
+}
+
+FrameStatus FrameReader::next(FrameSocket socket, std::vector<char>& frame) {
+    std::span<const char> view;
+    FrameStatus status = next(socket, view);
+    if (status == FrameStatus::OK) {
+        frame.assign(view.begin(), view.end());
+    }
+    return status;
+}
+
+FrameStatus FrameReader::next(FrameSocket socket, std::span<const char>& frame) {
+    while (true) {
+        size_t available = end_ - begin_;
+        size_t needed = sizeof(int);
+        if (available >= sizeof(int)) {
+            int length;
+            std::memcpy(&length, buffer_.data() + begin_, sizeof(int));
+            if (length < 0 || (max_frame_ != 0 && static_cast<size_t>(length) > max_frame_)) {
+                return FrameStatus::INVALID;
+            }
+            needed += length;
+            if (available >= needed) {
+                frame = std::span<const char>(buffer_.data() + begin_ + sizeof(int), length);
+                begin_ += needed;
+                return FrameStatus::OK;
+            }
+        }
+
+        // Mover lo pendiente al principio y dejar sitio para el resto del frame
+        if (begin_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + begin_, available);
+            begin_ = 0;
+            end_ = available;
+        }
+        buffer_.resize(std::max({buffer_.size(), needed, end_ + kReadSize}));
+
+        FrameStatus status;
+        if (!fill(socket, status)) {
+            return status;
+        }
+    }
+}
+
+bool FrameReader::fill(FrameSocket socket, FrameStatus& status) {
+    while (true) {
+        int received = recv(socket, buffer_.data() + end_, static_cast<int>(buffer_.size() - end_), 0);
+        reads_++;
+        if (received > 0) {
+            end_ += received;
+            return true;
+        }
+        if (received < 0 && interrupted()) {
+            continue;
+        }
+        status = received == 0 ? FrameStatus::CLOSED : FrameStatus::FAILED;
+        return false;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef FRAME_IO_H
+#define FRAME_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+using FrameSocket = SOCKET;
+#else
+using FrameSocket = int;
+#endif
+
+// Un frame es la longitud del mensaje (int de 4 bytes) seguida del mensaje.
+// Estas funciones son la única forma en que cliente y servidor escriben y
+// leen frames de un socket bloqueante.
+
+// Desactiva el algoritmo de Nagle. Con Nagle activo, el patrón escritura-
+// escritura-lectura de una petición pequeña espera al ACK retardado del otro
+// extremo (hasta 40 ms en cada sentido).
+bool setNoDelay(FrameSocket socket);
+
+// Envía la longitud y el mensaje con una sola llamada al sistema (sendmsg o
+// WSASend con dos buffers); sólo repite la llamada si el envío es parcial
+bool writeFrame(FrameSocket socket, const std::vector<char>& payload);
+
+// Igual, con varios frames seguidos en la misma llamada
+bool writeFrames(FrameSocket socket, const std::vector<std::vector<char>>& payloads);
+
+// Para codificar un mensaje directamente en un buffer de envío reutilizable:
+// beginFrame reserva la longitud al final de out, se añade el mensaje y
+// endFrame la completa. El buffer se envía luego entero con writeBytes.
+size_t beginFrame(std::vector<char>& out);
+void endFrame(std::vector<char>& out, size_t frame_start);
+bool writeBytes(FrameSocket socket, const char* data, size_t size);
+
+enum class FrameStatus {
+    OK,
+    CLOSED,         // El otro extremo cerró la conexión
+    FAILED,         // Error del socket (ver errno / WSAGetLastError)
+    INVALID         // Longitud negativa o mayor que el máximo
+};
+
+// Lee frames con un buffer propio: cada recv trae todo lo que haya disponible,
+// que pueden ser varios frames, y los siguientes se sirven sin llamar al sistema
+class FrameReader {
+public:
+    // max_frame = 0 no limita la longitud de los frames
+    explicit FrameReader(size_t max_frame = 0);
+
+    FrameStatus next(FrameSocket socket, std::vector<char>& frame);
+
+    // Sin copiar: frame apunta al buffer del lector hasta la siguiente llamada
+    FrameStatus next(FrameSocket socket, std::span<const char>& frame);
+    bool hasBuffered() const { return end_ > begin_; }
+    bool hasFrame() const;      // Hay un frame entero: next lo devuelve sin llamar al sistema
+    void reset();   // Descarta lo leído, p. ej. al reconectar
+
+    uint64_t reads() const { return reads_; }  // Llamadas a recv hechas
+
+private:
+    bool fill(FrameSocket socket, FrameStatus& status);
+
+    std::vector<char> buffer_;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+    size_t max_frame_;
+    uint64_t reads_ = 0;
+};
+
+#endif //FRAME_IO_H
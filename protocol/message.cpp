@@ -5,133 +5,360 @@
 #include "message.h"
 #include <iostream>
 
-Message::Message(MessageType type, int id, size_t size,
+Message::Message(MessageType type, int id, size_t size, uint32_t typeId,
                 const std::string& dataType, bool success,
                 const std::vector<char>& data)
-    : type_(type), id_(id), size_(size), data_type_(dataType),
+    : type_(type), id_(id), size_(size), type_id_(typeId), data_type_(dataType),
       success_(success), data_(data) {}
 
-Message Message::createRequest(size_t size, const std::string& type) {
-    return Message(MessageType::CREATE, -1, size, type);
+Message Message::createRequest(size_t size, uint32_t type_id, uint32_t weight) {
+    std::vector<char> data;
+    if (weight != 1) {
+        data.resize(sizeof(uint32_t));
+        std::memcpy(data.data(), &weight, sizeof(uint32_t));
+    }
+    return Message(MessageType::CREATE, -1, size, type_id, "", false, data);
+}
+
+Message Message::registerTypeRequest(uint32_t type_id, const std::string& type) {
+    return Message(MessageType::REGISTER_TYPE, -1, 0, type_id, type);
 }
 
 Message Message::setRequest(int id, const std::vector<char>& data) {
-    return Message(MessageType::SET, id, 0, "", false, data);
+    return Message(MessageType::SET, id, 0, 0, "", false, data);
 }
 
 Message Message::getRequest(int id) {
     return Message(MessageType::GET, id);
 }
 
-Message Message::refCountRequest(int id, bool increase) {
+Message Message::getRangeRequest(int id, size_t offset, uint32_t length) {
+    std::vector<char> data(sizeof(uint32_t));
+    std::memcpy(data.data(), &length, sizeof(uint32_t));
+    return Message(MessageType::GET_RANGE, id, offset, 0, "", false, data);
+}
+
+Message Message::setRangeRequest(int id, size_t offset, const std::vector<char>& data) {
+    return Message(MessageType::SET_RANGE, id, offset, 0, "", false, data);
+}
+
+Message Message::refCountRequest(int id, bool increase, uint32_t count) {
+    // Con una sola referencia el tamaño no se envía (en V2 no ocupa nada)
+    size_t size = count == 1 ? 0 : count;
     if (increase) {
-        return Message(MessageType::INCREASE_REF_COUNT, id);
+        return Message(MessageType::INCREASE_REF_COUNT, id, size);
     } else {
-        return Message(MessageType::DECREASE_REF_COUNT, id);
+        return Message(MessageType::DECREASE_REF_COUNT, id, size);
     }
 }
 
 Message Message::response(bool success, const std::vector<char>& data) {
-    return Message(MessageType::RESPONSE, -1, 0, "", success, data);
+    return Message(MessageType::RESPONSE, -1, 0, 0, "", success, data);
 }
 
-std::vector<char> Message::serialize() const {
+Message Message::linkRequest(int id, size_t offset, int target) {
+    std::vector<char> data(sizeof(int));
+    std::memcpy(data.data(), &target, sizeof(int));
+    return Message(MessageType::LINK, id, offset, 0, "", false, data);
+}
+
+namespace {
+
+// Campos presentes en un mensaje V2 (segundo byte)
+constexpr uint8_t kHasId = 0x01;
+constexpr uint8_t kHasSize = 0x02;
+constexpr uint8_t kHasTypeId = 0x04;
+constexpr uint8_t kHasDataType = 0x08;
+constexpr uint8_t kSuccess = 0x10;
+constexpr uint8_t kHasRequestId = 0x20;
+constexpr uint8_t kV2Marker = 0x80;
+
+// Tamaño de la parte fija de un mensaje V1, sin el nombre del tipo ni los datos
+constexpr size_t kV1FixedSize = sizeof(int) * 4 + sizeof(size_t) + sizeof(uint32_t) + 1;
+
+void appendBytes(std::vector<char>& out, const void* data, size_t size) {
+    size_t at = out.size();
+    out.resize(at + size);
+    if (size > 0) {
+        std::memcpy(out.data() + at, data, size);
+    }
+}
+
+void appendVarint(std::vector<char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t readVarint(std::span<const char> frame, size_t& offset) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= frame.size()) {
+            throw std::runtime_error("Buffer overrun while reading varint in deserialize");
+        }
+        uint8_t byte = static_cast<uint8_t>(frame[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Varint demasiado largo");
+}
+
+template <typename T>
+T readFixed(std::span<const char> frame, size_t& offset, const char* what) {
+    if (offset + sizeof(T) > frame.size()) {
+        throw std::runtime_error(std::string("Buffer overrun while reading ") + what + " in deserialize");
+    }
+    T value;
+    std::memcpy(&value, frame.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+// Los IDs son int: zigzag para que -1 u otro negativo no ocupe 10 bytes
+uint32_t zigzag(int value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int unzigzag(uint64_t value) {
+    auto bits = static_cast<uint32_t>(value);
+    return static_cast<int>((bits >> 1) ^ (~(bits & 1) + 1));
+}
+
+}
+
+std::vector<char> Message::serialize(WireFormat format) const {
     std::vector<char> buffer;
+    appendTo(buffer, format);
+    return buffer;
+}
 
-    // Agregar el tipo de mensaje (4 bytes)
-    int type_val = static_cast<int>(type_);
-    buffer.insert(buffer.end(), reinterpret_cast<char*>(&type_val),
-                  reinterpret_cast<char*>(&type_val) + sizeof(int));
+void Message::appendTo(std::vector<char>& out, WireFormat format, uint32_t request_id) const {
+    if (format == WireFormat::V2) {
+        uint8_t flags = (request_id != 0 ? kHasRequestId : 0) | (id_ != -1 ? kHasId : 0) | (size_ != 0 ? kHasSize : 0) |
+                        (type_id_ != 0 ? kHasTypeId : 0) | (!data_type_.empty() ? kHasDataType : 0) |
+                        (success_ ? kSuccess : 0);
+        out.push_back(static_cast<char>(kV2Marker | static_cast<uint8_t>(type_)));
+        out.push_back(static_cast<char>(flags));
+        if (flags & kHasRequestId) {
+            appendVarint(out, request_id);
+        }
+        if (flags & kHasId) {
+            appendVarint(out, zigzag(id_));
+        }
+        if (flags & kHasSize) {
+            appendVarint(out, size_);
+        }
+        if (flags & kHasTypeId) {
+            appendBytes(out, &type_id_, sizeof(uint32_t));
+        }
+        if (flags & kHasDataType) {
+            appendVarint(out, data_type_.size());
+            appendBytes(out, data_type_.data(), data_type_.size());
+        }
+        appendBytes(out, data_.data(), data_.size());
+        return;
+    }
 
-    // Agregar el ID (4 bytes)
-    buffer.insert(buffer.end(), reinterpret_cast<const char*>(&id_),
-                  reinterpret_cast<const char*>(&id_) + sizeof(int));
+    out.reserve(out.size() + kV1FixedSize + data_type_.size() + data_.size());
 
-    // Agregar el tamaño (8 bytes)
-    buffer.insert(buffer.end(), reinterpret_cast<const char*>(&size_),
-                  reinterpret_cast<const char*>(&size_) + sizeof(size_t));
+    // Tipo de mensaje (4 bytes), ID (4 bytes), tamaño (8 bytes), ID del tipo de datos (4 bytes)
+    int type_val = static_cast<int>(type_);
+    appendBytes(out, &type_val, sizeof(int));
+    appendBytes(out, &id_, sizeof(int));
+    appendBytes(out, &size_, sizeof(size_t));
+    appendBytes(out, &type_id_, sizeof(uint32_t));
 
-    // Agregar longitud del tipo de datos (4 bytes)
+    // Longitud del tipo de datos (4 bytes) y el tipo de datos (variable)
     int type_length = data_type_.size();
-    buffer.insert(buffer.end(), reinterpret_cast<char*>(&type_length),
-                  reinterpret_cast<char*>(&type_length) + sizeof(int));
+    appendBytes(out, &type_length, sizeof(int));
+    appendBytes(out, data_type_.data(), data_type_.size());
 
-    // Agregar el tipo de datos (variable)
-    buffer.insert(buffer.end(), data_type_.begin(), data_type_.end());
+    // Indicador de éxito (1 byte)
+    out.push_back(success_ ? 1 : 0);
 
-    // Agregar indicador de éxito (1 byte)
-    char success_val = success_ ? 1 : 0;
-    buffer.push_back(success_val);
-
-    // Agregar longitud de datos (4 bytes)
+    // Longitud de datos (4 bytes) y datos (variable)
     int data_size = data_.size();
-    buffer.insert(buffer.end(), reinterpret_cast<char*>(&data_size),
-                  reinterpret_cast<char*>(&data_size) + sizeof(int));
+    appendBytes(out, &data_size, sizeof(int));
+    appendBytes(out, data_.data(), data_.size());
+}
 
-    // Agregar datos (variable)
-    buffer.insert(buffer.end(), data_.begin(), data_.end());
+void Message::appendResponse(std::vector<char>& out, WireFormat format, uint32_t request_id, bool success,
+                             std::span<const char> data) {
+    size_t header_end = appendResponseHeader(out, format, request_id, success);
+    appendBytes(out, data.data(), data.size());
+    finishResponse(out, format, header_end);
+}
 
-    return buffer;
+size_t Message::appendResponseHeader(std::vector<char>& out, WireFormat format, uint32_t request_id, bool success) {
+    if (format == WireFormat::V2) {
+        out.push_back(static_cast<char>(kV2Marker | static_cast<uint8_t>(MessageType::RESPONSE)));
+        out.push_back(static_cast<char>((success ? kSuccess : 0) | (request_id != 0 ? kHasRequestId : 0)));
+        if (request_id != 0) {
+            appendVarint(out, request_id);
+        }
+        return out.size();
+    }
+
+    // Los mismos campos que serialize() para una respuesta sin datos; la
+    // longitud de los datos se completa en finishResponse
+    int type_val = static_cast<int>(MessageType::RESPONSE);
+    int id = -1;
+    size_t size = 0;
+    uint32_t type_id = 0;
+    int zero = 0;
+    appendBytes(out, &type_val, sizeof(int));
+    appendBytes(out, &id, sizeof(int));
+    appendBytes(out, &size, sizeof(size_t));
+    appendBytes(out, &type_id, sizeof(uint32_t));
+    appendBytes(out, &zero, sizeof(int));
+    out.push_back(success ? 1 : 0);
+    appendBytes(out, &zero, sizeof(int));
+    return out.size();
+}
+
+void Message::finishResponse(std::vector<char>& out, WireFormat format, size_t header_end) {
+    if (format == WireFormat::V1) {
+        int data_size = static_cast<int>(out.size() - header_end);
+        std::memcpy(out.data() + header_end - sizeof(int), &data_size, sizeof(int));
+    }
+}
+
+Message Message::chaseRequest(int id, size_t next_offset, uint32_t hops) {
+    std::vector<char> data(sizeof(uint32_t));
+    std::memcpy(data.data(), &hops, sizeof(uint32_t));
+    return Message(MessageType::CHASE, id, next_offset, 0, "", false, data);
+}
+
+Message Message::atomicRequest(int id, size_t offset, AtomicOp op, const std::vector<char>& value,
+                               const std::vector<char>& expected) {
+    std::vector<char> data;
+    data.reserve(1 + value.size() + expected.size());
+    data.push_back(static_cast<char>(op));
+    data.insert(data.end(), value.begin(), value.end());
+    data.insert(data.end(), expected.begin(), expected.end());
+    return Message(MessageType::ATOMIC, id, offset, 0, "", false, data);
+}
+
+Message Message::batchRequest(const std::vector<Message>& operations, WireFormat format) {
+    std::vector<char> data;
+    for (const Message& operation : operations) {
+        size_t frame_start = data.size();
+        data.resize(frame_start + sizeof(int));
+        operation.appendTo(data, format);
+        int length = static_cast<int>(data.size() - frame_start - sizeof(int));
+        std::memcpy(data.data() + frame_start, &length, sizeof(int));
+    }
+    return Message(MessageType::BATCH, -1, 0, 0, "", false, data);
+}
+
+std::vector<Message> Message::batchResponses(const Message& response) {
+    std::vector<Message> responses;
+    for (std::span<const char> frame : MessageView::splitBatch(response.data_)) {
+        responses.push_back(MessageView::decode(frame).toMessage());
+    }
+    return responses;
 }
 
 Message Message::deserialize(const std::vector<char>& buffer) {
-    if (buffer.size() < sizeof(int) * 3 + sizeof(size_t) + 1) {
+    return MessageView::decode(buffer).toMessage();
+}
+
+MessageView MessageView::decode(std::span<const char> frame) {
+    if (frame.empty()) {
         throw std::runtime_error("Buffer demasiado pequeño para deserializar");
     }
+    return formatOf(frame) == WireFormat::V2 ? decodeV2(frame) : decodeV1(frame);
+}
+
+WireFormat MessageView::formatOf(std::span<const char> frame) {
+    return !frame.empty() && (static_cast<uint8_t>(frame[0]) & kV2Marker) ? WireFormat::V2 : WireFormat::V1;
+}
 
+std::vector<std::span<const char>> MessageView::splitBatch(std::span<const char> data) {
+    std::vector<std::span<const char>> frames;
     size_t offset = 0;
+    while (offset < data.size()) {
+        int length = readFixed<int>(data, offset, "batch frame length");
+        if (length < 0 || static_cast<size_t>(length) > data.size() - offset) {
+            throw std::runtime_error("Buffer overrun while reading batch frame in deserialize");
+        }
+        frames.push_back(data.subspan(offset, length));
+        offset += length;
+    }
+    return frames;
+}
 
-    // Leer tipo de mensaje
-    int type_val;
-    std::memcpy(&type_val, buffer.data() + offset, sizeof(int));
-    offset += sizeof(int);
-    MessageType type = static_cast<MessageType>(type_val);
-
-    // Leer ID
-    int id;
-    std::memcpy(&id, buffer.data() + offset, sizeof(int));
-    offset += sizeof(int);
-
-    // Leer tamaño
-    size_t size;
-    std::memcpy(&size, buffer.data() + offset, sizeof(size_t));
-    offset += sizeof(size_t);
-
-    // Leer longitud del tipo de datos
-    int type_length;
-    std::memcpy(&type_length, buffer.data() + offset, sizeof(int));
-    offset += sizeof(int);
-
-    // Leer tipo de datos
-    if (offset + type_length > buffer.size()) {
-        throw std::runtime_error("Buffer overrun while reading data type string in deserialize");
+MessageView MessageView::decodeV2(std::span<const char> frame) {
+    if (frame.size() < 2) {
+        throw std::runtime_error("Buffer demasiado pequeño para deserializar");
     }
-    std::string data_type(buffer.data() + offset, buffer.data() + offset + type_length);
-    offset += type_length;
+    MessageView view;
+    view.format_ = WireFormat::V2;
+    view.type_ = static_cast<MessageType>(static_cast<uint8_t>(frame[0]) & ~kV2Marker);
+    uint8_t flags = static_cast<uint8_t>(frame[1]);
+    size_t offset = 2;
+
+    if (flags & kHasRequestId) {
+        view.request_id_ = static_cast<uint32_t>(readVarint(frame, offset));
+    }
+    if (flags & kHasId) {
+        view.id_ = unzigzag(readVarint(frame, offset));
+    }
+    if (flags & kHasSize) {
+        view.size_ = readVarint(frame, offset);
+    }
+    if (flags & kHasTypeId) {
+        view.type_id_ = readFixed<uint32_t>(frame, offset, "type id");
+    }
+    if (flags & kHasDataType) {
+        uint64_t length = readVarint(frame, offset);
+        if (length > frame.size() - offset) {
+            throw std::runtime_error("Buffer overrun while reading data type string in deserialize");
+        }
+        view.data_type_ = std::string_view(frame.data() + offset, length);
+        offset += length;
+    }
+    view.success_ = flags & kSuccess;
+    view.data_ = frame.subspan(offset);
+    return view;
+}
 
-    // Leer indicador de éxito
-    if (offset + 1 > buffer.size()) {
-         throw std::runtime_error("Buffer overrun while reading success flag in deserialize");
+MessageView MessageView::decodeV1(std::span<const char> frame) {
+    if (frame.size() < kV1FixedSize) {
+        throw std::runtime_error("Buffer demasiado pequeño para deserializar");
     }
-    bool success = buffer[offset] != 0;
-    offset += 1;
+    MessageView view;
+    view.format_ = WireFormat::V1;
+    size_t offset = 0;
+    view.type_ = static_cast<MessageType>(readFixed<int>(frame, offset, "message type"));
+    view.id_ = readFixed<int>(frame, offset, "id");
+    view.size_ = readFixed<size_t>(frame, offset, "size");
+    view.type_id_ = readFixed<uint32_t>(frame, offset, "type id");
 
-    // Leer longitud de datos
-    if (offset + sizeof(int) > buffer.size()) {
-         throw std::runtime_error("Buffer overrun while reading data size in deserialize");
+    int type_length = readFixed<int>(frame, offset, "data type length");
+    if (type_length < 0 || static_cast<size_t>(type_length) > frame.size() - offset) {
+        throw std::runtime_error("Buffer overrun while reading data type string in deserialize");
     }
-    int data_size;
-    std::memcpy(&data_size, buffer.data() + offset, sizeof(int));
-    offset += sizeof(int);
+    view.data_type_ = std::string_view(frame.data() + offset, type_length);
+    offset += type_length;
 
-    // Leer datos
-    std::vector<char> data;
-    if (data_size > 0) {
-         if (offset + data_size > buffer.size()) {
-             throw std::runtime_error("Buffer overrun while reading data payload in deserialize");
-         }
-        data.assign(buffer.data() + offset, buffer.data() + offset + data_size);
+    view.success_ = readFixed<char>(frame, offset, "success flag") != 0;
+
+    int data_size = readFixed<int>(frame, offset, "data size");
+    if (data_size < 0 || static_cast<size_t>(data_size) > frame.size() - offset) {
+        throw std::runtime_error("Buffer overrun while reading data payload in deserialize");
     }
+    view.data_ = frame.subspan(offset, data_size);
+    return view;
+}
 
-    return Message(type, id, size, data_type, success, data);
-}
\ No newline at end of file
+Message MessageView::toMessage() const {
+    Message message(type_, id_, size_, type_id_, std::string(data_type_), success_,
+                    std::vector<char>(data_.begin(), data_.end()));
+    message.request_id_ = request_id_;
+    return message;
+}
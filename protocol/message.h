@@ -7,6 +7,9 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <span>
+#include <cstdint>
 #include <cstring>
 #include <stdexcept>
 
@@ -16,38 +19,164 @@ enum class MessageType {
     GET,
     INCREASE_REF_COUNT,
     DECREASE_REF_COUNT,
-    RESPONSE
+    RESPONSE,
+    REGISTER_TYPE,
+    BATCH,      // Varias operaciones en un solo mensaje (ver batchRequest)
+    LINK,       // Escribe un ID de bloque dentro de otro bloque (ver linkRequest)
+    CHASE,      // Sigue una cadena de bloques en el servidor (ver chaseRequest)
+    GET_RANGE,  // Parte de un bloque: offset en el tamaño, longitud en los datos
+    SET_RANGE,  // Escribe los datos a partir del offset que lleva el tamaño
+    ATOMIC      // Operación atómica sobre un entero del bloque (ver atomicRequest)
+};
+
+// Operaciones de un mensaje ATOMIC
+enum class AtomicOp : uint8_t {
+    COMPARE_EXCHANGE,   // Escribe el valor sólo si el actual es el esperado
+    FETCH_ADD,          // Suma el valor (con desbordamiento modular)
+    EXCHANGE            // Escribe el valor
+};
+
+// Formato de los mensajes en el cable
+//  - V1: todos los campos siempre, de tamaño fijo (un GET ocupa 29 bytes).
+//  - V2: cabecera compacta. Un byte con 0x80 | tipo (en V1 el primer byte es
+//    el tipo, menor que 0x80, así que ambos formatos se distinguen por él),
+//    un byte de flags con los campos presentes y, en este orden, sólo los
+//    que lo están: ID de petición (varint), id (varint zigzag), tamaño
+//    (varint), ID de tipo (4 bytes) y nombre del tipo (varint con la
+//    longitud + bytes). Los datos, si los hay, ocupan el resto del frame.
+//    Un GET ocupa 6 bytes, o 7-8 con ID de petición.
+// El servidor responde a cada petición en el formato en que la recibió, y
+// en orden dentro de cada conexión. En V2 la respuesta repite el ID de
+// petición, con el que el cliente la asocia a quien la espera aunque tenga
+// muchas peticiones en vuelo; en V1 sólo cuenta el orden.
+enum class WireFormat {
+    V1,
+    V2
+};
+
+class Message;
+
+// Un mensaje decodificado sobre el buffer recibido, sin copiar nada ni
+// reservar memoria: el nombre del tipo y los datos apuntan a ese buffer,
+// así que la vista sólo es válida mientras el buffer no cambie.
+class MessageView {
+public:
+    // Acepta ambos formatos; lanza std::runtime_error si el mensaje está mal formado
+    static MessageView decode(std::span<const char> frame);
+    static WireFormat formatOf(std::span<const char> frame);    // Por el primer byte
+
+    // Separa los frames de los datos de un BATCH o de su respuesta; lanza
+    // std::runtime_error si alguno se sale de los datos
+    static std::vector<std::span<const char>> splitBatch(std::span<const char> data);
+
+    WireFormat getFormat() const { return format_; }
+    MessageType getType() const { return type_; }
+    uint32_t getRequestId() const { return request_id_; }     // 0 si no lleva
+    int getId() const { return id_; }
+    size_t getSize() const { return size_; }
+    uint32_t getTypeId() const { return type_id_; }
+    std::string_view getDataType() const { return data_type_; }
+    bool isSuccess() const { return success_; }
+    std::span<const char> getData() const { return data_; }
+
+    Message toMessage() const;      // Copia los campos a un Message
+
+private:
+    static MessageView decodeV1(std::span<const char> frame);
+    static MessageView decodeV2(std::span<const char> frame);
+
+    WireFormat format_ = WireFormat::V2;
+    MessageType type_ = MessageType::RESPONSE;
+    uint32_t request_id_ = 0;
+    int id_ = -1;
+    size_t size_ = 0;
+    uint32_t type_id_ = 0;
+    std::string_view data_type_;
+    bool success_ = false;
+    std::span<const char> data_;
 };
 
 class Message {
 public:
-    static Message createRequest(size_t size, const std::string& type);
+    // weight: referencias con las que nace el bloque (en los datos si no es 1)
+    static Message createRequest(size_t size, uint32_t type_id, uint32_t weight = 1);
+    static Message registerTypeRequest(uint32_t type_id, const std::string& type);
     static Message setRequest(int id, const std::vector<char>& data);
     static Message getRequest(int id);
-    static Message refCountRequest(int id, bool increase);
+    // Sólo los bytes [offset, offset + length) del bloque
+    static Message getRangeRequest(int id, size_t offset, uint32_t length);
+    static Message setRangeRequest(int id, size_t offset, const std::vector<char>& data);
+    // count (en el campo de tamaño) referencias de una vez; 0 equivale a 1
+    static Message refCountRequest(int id, bool increase, uint32_t count = 1);
     static Message response(bool success, const std::vector<char>& data = {});
 
-    std::vector<char> serialize() const;
-    static Message deserialize(const std::vector<char>& buffer);
+    // Escribe target (un ID de bloque) en el bloque id, a partir del byte offset
+    static Message linkRequest(int id, size_t offset, int target);
+
+    // Parte del bloque id y salta hops veces al bloque cuyo ID está en el
+    // byte next_offset del actual. La respuesta lleva el ID del bloque al que
+    // llega (int) seguido de su contenido; falla si la cadena acaba antes.
+    static Message chaseRequest(int id, size_t next_offset, uint32_t hops);
+
+    // Aplica op al entero de 4 u 8 bytes (value.size()) que empieza en el byte
+    // offset del bloque id, sin que otra petición lo lea o escriba a la vez.
+    // Los datos llevan op, value y, sólo en COMPARE_EXCHANGE, expected, del
+    // mismo tamaño. La respuesta lleva el valor anterior: el intercambio se
+    // hizo si coincide con expected.
+    static Message atomicRequest(int id, size_t offset, AtomicOp op, const std::vector<char>& value,
+                                 const std::vector<char>& expected = {});
+
+    // Un BATCH lleva las operaciones en orden, cada una como un frame (longitud
+    // + mensaje) dentro de los datos. El servidor las ejecuta todas seguidas,
+    // sin que otra petición se intercale, y responde con un frame por cada una.
+    // Dentro de un BATCH, batchRef(k) sirve como ID (también como target de un
+    // LINK) y se sustituye por el bloque de la operación k: el creado, si es un
+    // CREATE, o aquel sobre el que actuó. Si la operación k falló, las que se
+    // refieren a ella fallan también.
+    static Message batchRequest(const std::vector<Message>& operations, WireFormat format);
+    static std::vector<Message> batchResponses(const Message& response);
+    static constexpr int batchRef(size_t index) { return -2 - static_cast<int>(index); }
+
+    std::vector<char> serialize(WireFormat format = WireFormat::V1) const;
+    static Message deserialize(const std::vector<char>& buffer);   // Cualquiera de los dos formatos
+
+    // Añade el mensaje codificado al final de out, sin vaciarlo, para poder
+    // reutilizar el mismo buffer de envío en cada mensaje
+    // request_id (sólo V2) identifica la petición en su respuesta; 0 = sin ID
+    void appendTo(std::vector<char>& out, WireFormat format, uint32_t request_id = 0) const;
+
+    // Respuestas escritas directamente en out, sin construir un Message.
+    // Para rellenar los datos en su sitio: appendResponseHeader, añadir los
+    // datos al final de out y finishResponse con lo que devolvió la primera.
+    static void appendResponse(std::vector<char>& out, WireFormat format, uint32_t request_id, bool success,
+                               std::span<const char> data = {});
+    static size_t appendResponseHeader(std::vector<char>& out, WireFormat format, uint32_t request_id, bool success);
+    static void finishResponse(std::vector<char>& out, WireFormat format, size_t header_end);
 
     // Getters para propiedades del mensaje
     MessageType getType() const { return type_; }
+    uint32_t getRequestId() const { return request_id_; }
     int getId() const { return id_; }
     size_t getSize() const { return size_; }
+    uint32_t getTypeId() const { return type_id_; }
     const std::string& getDataType() const { return data_type_; }
     bool isSuccess() const { return success_; }
     const std::vector<char>& getData() const { return data_; }
 
 private:
     MessageType type_;
+    uint32_t request_id_ = 0;     // ID de petición con que llegó (sólo V2)
     int id_;                      // ID del bloque de memoria
-    size_t size_;                 // Tamaño a reservar (para CREATE)
-    std::string data_type_;       // Tipo de datos (para CREATE)
+    size_t size_;                 // Tamaño a reservar (para CREATE) u offset (para LINK, CHASE, ATOMIC y los *_RANGE)
+    uint32_t type_id_;            // ID del tipo de datos (para CREATE y REGISTER_TYPE)
+    std::string data_type_;       // Nombre del tipo de datos (sólo para REGISTER_TYPE)
     bool success_;                // Éxito/fracaso (para RESPONSE)
     std::vector<char> data_;      // Datos serializados
 
+    friend class MessageView;
+
     // Constructor privado para uso interno
-    Message(MessageType type, int id = -1, size_t size = 0,
+    Message(MessageType type, int id = -1, size_t size = 0, uint32_t typeId = 0,
             const std::string& dataType = "", bool success = false,
             const std::vector<char>& data = {});
 };
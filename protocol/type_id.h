@@ -0,0 +1,19 @@
+#ifndef TYPE_ID_H
+#define TYPE_ID_H
+
+#include <cstdint>
+#include <string_view>
+
+// Identificador compacto de un tipo: hash FNV-1a de 32 bits de su nombre.
+// El cliente registra cada nombre una sola vez por conexión (REGISTER_TYPE)
+// y a partir de ahí CREATE sólo envía estos 4 bytes.
+constexpr uint32_t typeIdOf(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#endif //TYPE_ID_H
@@ -5,7 +5,7 @@
 
 #include "../memory_manager/memory_manager.h"
 #include "../memory_manager/garbage_collector.h"
-#include "../memory_manager/socket_server.h"
+#include "../memory_manager/network_server.h"
 #include <iostream>
 #include <string>
 #include <thread>
@@ -35,12 +35,25 @@ void signalHandler(int signum) {
 
 void printUsage(const char* programName) {
     std::cout << "Uso: " << programName
-              << " --port PORT --memsize SIZE_MB --dumpFolder DUMP_FOLDER" << std::endl;
+              << " --port PORT --memsize SIZE_MB --dumpFolder DUMP_FOLDER"
+              << " [--allocator freelist|tlsf|buddy] [--slabThreshold BYTES]"
+              << " [--compactStepBytes BYTES] [--compactStepMicros US]"
+              << " [--compactionMode sliding|concurrent] [--shards N]"
+              << " [--dumpMode text|journal] [--netBackend threads|epoll|io_uring] [--workers N]" << std::endl;
     std::cout << "\nEjemplo: " << programName << " --port 9090 --memsize 64 --dumpFolder dumps" << std::endl;
     std::cout << "\nParámetros:" << std::endl;
     std::cout << "  --port PORT         Puerto para escuchar conexiones (ej: 9090)" << std::endl;
     std::cout << "  --memsize SIZE_MB   Tamaño de memoria a reservar en MB (ej: 64)" << std::endl;
     std::cout << "  --dumpFolder PATH   Carpeta para guardar archivos de volcado de memoria" << std::endl;
+    std::cout << "  --allocator POLICY  Política de asignación: freelist (por defecto), tlsf o buddy" << std::endl;
+    std::cout << "  --slabThreshold N   Bloques de hasta N bytes se sirven desde slabs (0 = desactivado, por defecto " << kDefaultSlabThreshold << ")" << std::endl;
+    std::cout << "  --compactStepBytes N   Bytes movidos como máximo por paso de compactación (0 = sin límite, por defecto 262144)" << std::endl;
+    std::cout << "  --compactStepMicros N  Duración máxima de un paso de compactación en µs (0 = sin límite, por defecto 2000)" << std::endl;
+    std::cout << "  --compactionMode M     sliding (por defecto): desliza bloques con el mutex tomado; concurrent: copia cada bloque sin bloquear las demás peticiones" << std::endl;
+    std::cout << "  --shards N             Divide la memoria en N arenas independientes, cada una con su propio mutex (por defecto 1)" << std::endl;
+    std::cout << "  --dumpMode M           text (por defecto): un archivo de volcado legible por ráfaga de cambios; journal: registros binarios en un journal rotativo (ver journal_replay)" << std::endl;
+    std::cout << "  --netBackend B         threads (por defecto): un hilo por cliente; epoll (solo Linux): un bucle de eventos y un pool fijo de hilos; io_uring (Linux 6.0+): envíos y recepciones agrupados en un io_uring, con epoll como respaldo" << std::endl;
+    std::cout << "  --workers N            Hilos que atienden peticiones con --netBackend epoll o io_uring (por defecto, uno por núcleo)" << std::endl;
 }
 
 void printMemoryStatus(MemoryManager* memoryManager) {
@@ -70,6 +83,14 @@ int main(int argc, char* argv[]) {
     int port = 0;
     size_t memsize = 0;
     std::string dumpFolder;
+    AllocationPolicy allocator = AllocationPolicy::FREE_LIST;
+    size_t slabThreshold = kDefaultSlabThreshold;
+    CompactionBudget compactionBudget;
+    CompactionMode compactionMode = CompactionMode::SLIDING;
+    size_t shards = 1;
+    DumpMode dumpMode = DumpMode::TEXT;
+    NetworkBackend netBackend = NetworkBackend::THREADS;
+    size_t workers = 0;
 
     // Simple argument parsing
     for (int i = 1; i < argc; i += 2) {
@@ -86,6 +107,50 @@ int main(int argc, char* argv[]) {
             memsize = std::stoi(argv[i + 1]);
         } else if (arg == "--dumpFolder") {
             dumpFolder = argv[i + 1];
+        } else if (arg == "--allocator") {
+            if (!parseAllocationPolicy(argv[i + 1], allocator)) {
+                std::cerr << "Error: Política de asignación desconocida: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--slabThreshold") {
+            slabThreshold = std::stoul(argv[i + 1]);
+            if (slabThreshold > kMaxSlabThreshold) {
+                std::cerr << "Error: Umbral de slab inválido (máximo " << kMaxSlabThreshold << "): " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--compactStepBytes") {
+            compactionBudget.max_bytes = std::stoul(argv[i + 1]);
+        } else if (arg == "--compactStepMicros") {
+            compactionBudget.max_time = std::chrono::microseconds(std::stoul(argv[i + 1]));
+        } else if (arg == "--shards") {
+            shards = std::stoul(argv[i + 1]);
+            if (shards == 0 || shards > MemoryManager::kMaxShards) {
+                std::cerr << "Error: Número de shards inválido (1 a " << MemoryManager::kMaxShards << "): " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--compactionMode") {
+            if (!parseCompactionMode(argv[i + 1], compactionMode)) {
+                std::cerr << "Error: Modo de compactación desconocido: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--dumpMode") {
+            if (!parseDumpMode(argv[i + 1], dumpMode)) {
+                std::cerr << "Error: Modo de volcado desconocido: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--netBackend") {
+            if (!parseNetworkBackend(argv[i + 1], netBackend)) {
+                std::cerr << "Error: Backend de red desconocido o no disponible en esta plataforma: " << argv[i + 1] << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--workers") {
+            workers = std::stoul(argv[i + 1]);
         } else {
             std::cerr << "Error: Argumento desconocido: " << arg << std::endl;
             printUsage(argv[0]);
@@ -109,17 +174,17 @@ int main(int argc, char* argv[]) {
     try {
         std::cout << "Iniciando Memory Manager con " << memsize << "MB de memoria..." << std::endl;
         // Initialize memory manager
-        MemoryManager memoryManager(memsize, dumpFolder);
+        MemoryManager memoryManager(memsize, dumpFolder, allocator, slabThreshold, shards, dumpMode);
 
         std::cout << "Iniciando recolector de basura..." << std::endl;
         // Start garbage collector
-        GarbageCollector garbageCollector(&memoryManager);
+        GarbageCollector garbageCollector(&memoryManager, compactionBudget, compactionMode);
         garbageCollector.start();
 
         std::cout << "Iniciando servidor de sockets en puerto " << port << "..." << std::endl;
         // Start socket server
-        SocketServer server(port, &memoryManager);
-        server.start();
+        std::unique_ptr<NetworkServer> server = makeNetworkServer(netBackend, port, &memoryManager, workers);
+        server->start();
 
         std::cout << "\nServidor ejecutándose. Presione Ctrl+C para finalizar.\n" << std::endl;
         std::cout << "Comandos disponibles:" << std::endl;
@@ -148,7 +213,7 @@ int main(int argc, char* argv[]) {
 
         // Cleanup
         std::cout << "Deteniendo servicios..." << std::endl;
-        server.stop();
+        server->stop();
         garbageCollector.stop();
         std::cout << "Servidor finalizado correctamente." << std::endl;
 
@@ -0,0 +1,617 @@
+// memory_manager_test.cpp
+// Pruebas del lado del servidor que no necesitan red: los asignadores y el
+// MemoryManager se usan directamente, así que se compilan y corren en
+// cualquier plataforma sin levantar un memory_manager.
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <random>
+#include <vector>
+#include "../memory_manager/allocator.h"
+#include "../memory_manager/tlsf_allocator.h"
+#include "../memory_manager/slab_allocator.h"
+#include "../memory_manager/buddy_allocator.h"
+#include "../memory_manager/memory_manager.h"
+#include "../memory_manager/dump_writer.h"
+#include "../memory_manager/journal.h"
+
+namespace {
+
+struct Extent {
+    size_t offset;
+    size_t size;
+    uint32_t handle;
+};
+
+// Ningún par de extents reservados se solapa
+bool sinSolapes(const std::vector<Extent>& extents) {
+    for (size_t i = 0; i < extents.size(); i++) {
+        for (size_t j = i + 1; j < extents.size(); j++) {
+            const Extent& a = extents[i];
+            const Extent& b = extents[j];
+            if (a.offset < b.offset + b.size && b.offset < a.offset + a.size) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Reserva bloques de tamaños variados hasta llenar buena parte del pool, los
+// libera en orden aleatorio y comprueba que todo vuelve a fundirse en un único
+// extent libre del tamaño inicial
+void comprobarIdaYVuelta(Allocator& asignador, size_t tam_pool) {
+    assert(asignador.freeBytes() == tam_pool);
+    assert(asignador.freeExtentCount() == 1);
+
+    std::mt19937 azar(1234);
+    std::vector<Extent> reservados;
+    for (int i = 0; i < 200; i++) {
+        Extent e{0, 16 + azar() % 300, 0};
+        if (!asignador.allocate(e.size, e.offset, e.handle)) {
+            break;
+        }
+        assert(e.offset + e.size <= tam_pool);
+        reservados.push_back(e);
+    }
+    assert(reservados.size() > 50);
+    assert(sinSolapes(reservados));
+    assert(asignador.freeBytes() < tam_pool);
+
+    std::shuffle(reservados.begin(), reservados.end(), azar);
+    for (const Extent& e : reservados) {
+        asignador.release(e.offset, e.size, e.handle);
+    }
+    assert(asignador.freeBytes() == tam_pool);
+    assert(asignador.freeExtentCount() == 1);
+    assert(asignador.largestFreeExtent() == tam_pool);
+}
+
+}
+
+void test_tlsf() {
+    std::cout << "Ejecutando prueba del asignador TLSF..." << std::endl;
+
+    const size_t tam = 64 * 1024;
+    TlsfAllocator tlsf(tam);
+    comprobarIdaYVuelta(tlsf, tam);
+
+    // Los tamaños se redondean a 8 bytes y los extents se cortan uno tras otro
+    Extent a{0, 100, 0}, b{0, 100, 0}, c{0, 100, 0};
+    assert(tlsf.allocate(a.size, a.offset, a.handle));
+    assert(tlsf.allocate(b.size, b.offset, b.handle));
+    assert(tlsf.allocate(c.size, c.offset, c.handle));
+    assert(tlsf.freeBytes() == tam - 3 * 104);
+    assert(sinSolapes({a, b, c}));
+
+    // El hueco de b queda aparte; al liberar a se une a él, y c une todo
+    tlsf.release(b.offset, b.size, b.handle);
+    assert(tlsf.freeExtentCount() == 2);
+    tlsf.release(a.offset, a.size, a.handle);
+    assert(tlsf.freeExtentCount() == 2);
+    assert(tlsf.largestFreeExtent() == tam - 3 * 104);
+
+    // c baja al hueco que tiene justo debajo, que pasa a unirse con el final
+    size_t offset = c.offset;
+    assert(tlsf.slideDown(offset, c.size, c.handle));
+    assert(offset == 0);
+    assert(tlsf.freeExtentCount() == 1);
+    assert(!tlsf.slideDown(offset, c.size, c.handle));  // Ya no hay nada libre debajo
+    tlsf.release(offset, c.size, c.handle);
+    assert(tlsf.freeExtentCount() == 1 && tlsf.freeBytes() == tam);
+
+    assert(!tlsf.allocate(0, offset, a.handle));
+    assert(!tlsf.allocate(tam + 8, offset, a.handle));
+
+    // La lista libre ordenada por tamaño debe cumplir lo mismo
+    std::unique_ptr<Allocator> lista = makeAllocator(AllocationPolicy::FREE_LIST, tam);
+    comprobarIdaYVuelta(*lista, tam);
+
+    std::cout << "Prueba del asignador TLSF completada." << std::endl;
+}
+
+void test_slabs() {
+    std::cout << "\nEjecutando prueba del asignador de slabs..." << std::endl;
+
+    const size_t tam = 64 * 1024;
+    SlabAllocator slabs(makeAllocator(AllocationPolicy::FREE_LIST, tam), kDefaultSlabThreshold);
+
+    // 64 objetos de 8 bytes caben en un slab; el siguiente abre otro
+    std::vector<Extent> pequenos;
+    for (int i = 0; i < 65; i++) {
+        Extent e{0, 8, 0};
+        assert(slabs.allocate(e.size, e.offset, e.handle));
+        pequenos.push_back(e);
+    }
+    assert(slabs.slabCount() == 2);
+    assert(sinSolapes(pequenos));
+    assert(slabs.freeBytes() == tam - 2 * 64 * 8);
+
+    // Los huecos de los slabs no se mueven al compactar
+    size_t offset = pequenos.back().offset;
+    assert(slabs.pinned(pequenos.back().handle));
+    assert(!slabs.slideDown(offset, 8, pequenos.back().handle));
+
+    // Lo que pasa del umbral va al asignador de respaldo, que sí compacta
+    Extent grande{0, 1000, 0};
+    assert(slabs.allocate(grande.size, grande.offset, grande.handle));
+    assert(slabs.slabCount() == 2);
+    assert(slabs.freeBytes() == tam - 2 * 64 * 8 - 1000);
+    assert(!slabs.pinned(grande.handle));
+
+    // Un hueco liberado se reutiliza antes de abrir otro slab
+    slabs.release(pequenos[10].offset, 8, pequenos[10].handle);
+    Extent otro{0, 8, 0};
+    assert(slabs.allocate(otro.size, otro.offset, otro.handle));
+    assert(otro.offset == pequenos[10].offset);
+    pequenos[10] = otro;
+
+    // Vacíos, uno de los slabs se guarda para el próximo pico y el otro vuelve al respaldo
+    for (const Extent& e : pequenos) {
+        slabs.release(e.offset, e.size, e.handle);
+    }
+    assert(slabs.slabCount() == 1);
+    assert(slabs.freeBytes() == tam - 64 * 8 - 1000);
+
+    // El segundo slab quedaba justo debajo del bloque grande, que baja a su hueco
+    offset = grande.offset;
+    assert(slabs.slideDown(offset, grande.size, grande.handle));
+    assert(offset == grande.offset - 64 * 8);
+    slabs.release(offset, grande.size, grande.handle);
+    assert(slabs.freeBytes() == tam - 64 * 8);
+
+    std::cout << "Prueba del asignador de slabs completada." << std::endl;
+}
+
+void test_buddy() {
+    std::cout << "\nEjecutando prueba del asignador buddy..." << std::endl;
+
+    const size_t tam = 64 * 1024;
+    BuddyAllocator buddy(tam);
+    assert(buddy.freeExtentCount() == 1 && buddy.largestFreeExtent() == tam);
+    assert(!buddy.supportsCompaction());
+
+    // Cada petición se redondea a una potencia de dos alineada a su tamaño
+    Extent a{0, 100, 0};
+    assert(buddy.allocate(a.size, a.offset, a.handle));
+    assert(a.offset % 128 == 0);
+    assert(buddy.freeBytes() == tam - 128);
+
+    // Partir el pool deja libre una mitad por cada orden entre 128 bytes y 64 KB
+    assert(buddy.freeExtentCount() == 9);
+
+    // Dos bloques de 16 bytes: el segundo es el compañero del primero (offset ^ 16)
+    Extent b{0, 16, 0}, c{0, 16, 0};
+    assert(buddy.allocate(b.size, b.offset, b.handle));
+    assert(buddy.allocate(c.size, c.offset, c.handle));
+    assert(c.offset == (b.offset ^ 16));
+    size_t offset = c.offset;
+    assert(!buddy.slideDown(offset, c.size, c.handle));
+
+    // Liberar los tres vuelve a fundir todo, orden a orden, en un solo bloque
+    buddy.release(b.offset, b.size, b.handle);
+    assert(buddy.freeExtentCount() > 1);
+    buddy.release(c.offset, c.size, c.handle);
+    buddy.release(a.offset, a.size, a.handle);
+    assert(buddy.freeBytes() == tam);
+    assert(buddy.freeExtentCount() == 1);
+    assert(buddy.largestFreeExtent() == tam);
+    comprobarIdaYVuelta(buddy, tam);
+
+    // Un pool que no es potencia de dos se cubre con bloques alineados (32 KB + 16 KB)
+    // y no se funde más allá de su final
+    BuddyAllocator irregular(48 * 1024);
+    assert(irregular.freeExtentCount() == 2);
+    assert(irregular.largestFreeExtent() == 32 * 1024);
+    Extent d{0, 16 * 1024, 0};
+    assert(irregular.allocate(d.size, d.offset, d.handle));
+    assert(d.offset == 32 * 1024);
+    irregular.release(d.offset, d.size, d.handle);
+    assert(irregular.freeExtentCount() == 2 && irregular.freeBytes() == 48 * 1024);
+
+    std::cout << "Prueba del asignador buddy completada." << std::endl;
+}
+
+// Acceso a las partes privadas del MemoryManager que el recolector usa
+struct MemoryManagerTest {
+    static bool compactStep(MemoryManager& mm, const CompactionBudget& presupuesto) {
+        return mm.compactStep(presupuesto);
+    }
+    static bool relocateStep(MemoryManager& mm, const CompactionBudget& presupuesto) {
+        return mm.relocateStep(presupuesto);
+    }
+    static void reclaim(MemoryManager& mm) {
+        for (auto& shard : mm.shards_) {
+            mm.reclaim(*shard);
+        }
+    }
+    static size_t cursor(MemoryManager& mm) { return mm.shards_[0]->compact_cursor; }
+    static const Allocator& allocator(MemoryManager& mm) { return *mm.shards_[0]->allocator; }
+
+    // Índice del shard al que shardOf lleva un id, o -1 si a ninguno
+    static int shardIndexOf(MemoryManager& mm, int id) {
+        MemoryManager::Shard* shard = mm.shardOf(id);
+        for (size_t i = 0; i < mm.shards_.size(); i++) {
+            if (mm.shards_[i].get() == shard) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+    static size_t shardBase(MemoryManager& mm, size_t index) {
+        return static_cast<size_t>(mm.shards_[index]->pool - mm.memory_pool_);
+    }
+
+    static size_t offsetOf(MemoryManager& mm, int id) {
+        MemoryManager::Shard* shard = mm.shardOf(id);
+        uint32_t slot;
+        assert(shard && shard->blocks.find(id, slot));
+        return static_cast<size_t>(shard->pool - mm.memory_pool_) + shard->blocks.offset(slot);
+    }
+};
+
+namespace {
+
+std::string carpetaDeDumps() {
+    std::filesystem::path carpeta = std::filesystem::temp_directory_path() / "memory_manager_test";
+    std::filesystem::create_directories(carpeta);
+    return carpeta.string();
+}
+
+// Ocho bloques de 1000 bytes seguidos, cada uno lleno con su índice; se liberan
+// los pares para dejar cuatro huecos intercalados
+std::vector<int> crearHuecos(MemoryManager& mm) {
+    std::vector<int> ids;
+    for (int i = 0; i < 8; i++) {
+        int id = mm.create(1000, 0);
+        assert(id >= 0);
+        std::vector<char> datos(1000, static_cast<char>('a' + i));
+        assert(mm.set(id, datos.data(), datos.size()));
+        ids.push_back(id);
+    }
+    for (int i = 0; i < 8; i += 2) {
+        assert(mm.decreaseRefCount(ids[i]));
+    }
+    MemoryManagerTest::reclaim(mm);
+    assert(MemoryManagerTest::allocator(mm).freeExtentCount() == 5);
+    return ids;
+}
+
+// Los bloques que quedan (los impares) conservan su contenido
+void comprobarContenido(MemoryManager& mm, const std::vector<int>& ids) {
+    for (int i = 1; i < 8; i += 2) {
+        std::vector<char> datos;
+        assert(mm.get(ids[i], datos));
+        assert(datos == std::vector<char>(1000, static_cast<char>('a' + i)));
+    }
+}
+
+}
+
+void test_incremental_compaction() {
+    std::cout << "\nEjecutando prueba de compactación incremental..." << std::endl;
+
+    MemoryManager mm(1, carpetaDeDumps(), AllocationPolicy::FREE_LIST, 0);
+    std::vector<int> ids = crearHuecos(mm);
+
+    // Con un presupuesto de 1000 bytes cada paso mueve un bloque y deja el
+    // cursor justo detrás de él; el siguiente sigue desde ahí
+    CompactionBudget presupuesto{1000, std::chrono::microseconds(0)};
+    assert(!MemoryManagerTest::compactStep(mm, presupuesto));
+    assert(MemoryManagerTest::offsetOf(mm, ids[1]) == 0);
+    assert(MemoryManagerTest::cursor(mm) == 2000);
+    assert(MemoryManagerTest::offsetOf(mm, ids[3]) == 3000);     // Aún sin tocar
+
+    assert(!MemoryManagerTest::compactStep(mm, presupuesto));
+    assert(MemoryManagerTest::offsetOf(mm, ids[3]) == 1000);
+    assert(MemoryManagerTest::cursor(mm) == 4000);
+
+    assert(!MemoryManagerTest::compactStep(mm, presupuesto));
+    assert(MemoryManagerTest::compactStep(mm, presupuesto));     // El último bloque termina la pasada
+    assert(MemoryManagerTest::cursor(mm) == 0);
+
+    for (int i = 1; i < 8; i += 2) {
+        assert(MemoryManagerTest::offsetOf(mm, ids[i]) == static_cast<size_t>(i / 2) * 1000);
+    }
+    assert(MemoryManagerTest::allocator(mm).freeExtentCount() == 1);
+    comprobarContenido(mm, ids);
+
+    // Sin nada que juntar, un paso termina enseguida
+    assert(MemoryManagerTest::compactStep(mm, presupuesto));
+
+    std::cout << "Prueba de compactación incremental completada." << std::endl;
+}
+
+void test_concurrent_compaction() {
+    std::cout << "\nEjecutando prueba de compactación concurrente..." << std::endl;
+
+    MemoryManager mm(1, carpetaDeDumps(), AllocationPolicy::FREE_LIST, 0);
+    std::vector<int> ids = crearHuecos(mm);
+    size_t extents = MemoryManagerTest::allocator(mm).freeExtentCount();
+
+    // Cada bloque se copia a un extent libre más bajo, si lo hay, fuera del mutex
+    CompactionBudget sin_limite{0, std::chrono::microseconds(0)};
+    while (!MemoryManagerTest::relocateStep(mm, sin_limite)) {
+    }
+    assert(MemoryManagerTest::offsetOf(mm, ids[1]) == 0);
+    assert(MemoryManagerTest::allocator(mm).freeExtentCount() < extents);
+    assert(MemoryManagerTest::cursor(mm) == 0);
+    comprobarContenido(mm, ids);
+
+    // Ningún bloque quedó a medio mover: otra pasada completa no cambia el contenido
+    while (!MemoryManagerTest::relocateStep(mm, sin_limite)) {
+    }
+    comprobarContenido(mm, ids);
+
+    // Un SET mientras se copia el bloque: la copia se descarta y no se pierde
+    // nada. Las dos partes acceden a los bytes con atómicos, así que con
+    // -fsanitize=thread esto no es una carrera
+    MemoryManager otro(1, carpetaDeDumps(), AllocationPolicy::FREE_LIST, 0);
+    std::vector<int> otros = crearHuecos(otro);
+    std::atomic<bool> escribiendo{true};
+    std::thread escritor([&] {
+        std::vector<char> datos(1000, 'b');
+        while (escribiendo.load()) {
+            assert(otro.set(otros[1], datos.data(), datos.size()));
+        }
+    });
+    for (int pasada = 0; pasada < 20; pasada++) {
+        while (!MemoryManagerTest::relocateStep(otro, sin_limite)) {
+        }
+    }
+    escribiendo = false;
+    escritor.join();
+    comprobarContenido(otro, otros);
+
+    std::cout << "Prueba de compactación concurrente completada." << std::endl;
+}
+
+void test_shard_routing() {
+    std::cout << "\nEjecutando prueba del reparto en shards..." << std::endl;
+
+    // 1 MB en cuatro shards de 256 KB; los bloques se reparten por turnos
+    MemoryManager mm(1, carpetaDeDumps(), AllocationPolicy::FREE_LIST, 0, 4);
+    const size_t tam_shard = 256 * 1024;
+    std::vector<int> ids;
+    ids.push_back(mm.create(250 * 1000, 0));
+    for (int i = 1; i < 4; i++) {
+        ids.push_back(mm.create(16, 0));
+    }
+    for (int i = 0; i < 4; i++) {
+        assert(ids[i] >= 0);
+        assert(MemoryManagerTest::shardIndexOf(mm, ids[i]) == i);
+        size_t offset = MemoryManagerTest::offsetOf(mm, ids[i]);
+        assert(offset >= MemoryManagerTest::shardBase(mm, i) &&
+               offset < MemoryManagerTest::shardBase(mm, i) + tam_shard);
+        assert(mm.set(ids[i], &i, sizeof(i)));
+    }
+
+    // Al shard 0 le toca otra vez, pero ya no le cabe: pasa al siguiente
+    int desbordado = mm.create(100 * 1000, 0);
+    assert(desbordado >= 0);
+    assert(MemoryManagerTest::shardIndexOf(mm, desbordado) == 1);
+
+    // Cada id sigue llevando a su propio bloque
+    for (int i = 0; i < 4; i++) {
+        int valor = -1;
+        assert(mm.get(ids[i], &valor, sizeof(valor)));
+        assert(valor == i);
+    }
+    assert(mm.create(300 * 1000, 0) == -1);    // Hay sitio en total, pero un bloque no cruza shards
+
+    // CHASE sigue una cadena que pasa por varios shards, bloqueando uno por salto
+    std::vector<int> cadena;
+    for (int i = 0; i < 4; i++) {
+        cadena.push_back(mm.create(sizeof(int), 0));
+        assert(cadena[i] >= 0);
+    }
+    for (int i = 0; i + 1 < 4; i++) {
+        assert(mm.set(cadena[i], &cadena[i + 1], sizeof(int)));
+    }
+    assert(MemoryManagerTest::shardIndexOf(mm, cadena[0]) != MemoryManagerTest::shardIndexOf(mm, cadena[1]));
+    std::vector<char> final;
+    assert(mm.chase(cadena[0], 0, 3, final) == cadena[3]);
+    assert(final.size() == sizeof(int));
+    // Un eslabón liberado corta la cadena
+    assert(mm.decreaseRefCount(cadena[2]));
+    MemoryManagerTest::reclaim(mm);
+    assert(mm.chase(cadena[0], 0, 3, final) == -1);
+
+    // Con tres shards, los ids cuyo índice apunta a un cuarto no son de nadie
+    MemoryManager tres(1, carpetaDeDumps(), AllocationPolicy::FREE_LIST, 0, 3);
+    int fuera = (1 << BlockTable::kIndexBits) | (3 << (BlockTable::kIndexBits - 2));
+    assert(MemoryManagerTest::shardIndexOf(tres, fuera) == -1);
+    std::vector<char> datos;
+    assert(!tres.get(fuera, datos));
+    assert(!tres.increaseRefCount(fuera));
+    assert(MemoryManagerTest::shardIndexOf(tres, -1) == -1);
+
+    std::cout << "Prueba del reparto en shards completada." << std::endl;
+}
+
+namespace {
+
+// Lo que recibe la función de escritura de un DumpWriter, llamada a llamada
+struct Escrituras {
+    std::mutex mutex;
+    std::vector<std::vector<ChangeEvent>> lotes;
+    size_t perdidos = 0;
+
+    DumpWriter::WriteFunction funcion() {
+        return [this](const std::vector<ChangeEvent>& changes, size_t lost) {
+            std::lock_guard<std::mutex> lock(mutex);
+            lotes.push_back(changes);
+            perdidos += lost;
+        };
+    }
+
+    size_t escritos() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t total = 0;
+        for (const auto& lote : lotes) {
+            total += lote.size();
+        }
+        return total;
+    }
+
+    // Espera (como mucho dos segundos) a que se hayan escrito o perdido n cambios
+    bool esperar(size_t n) {
+        for (int i = 0; i < 200; i++) {
+            size_t perdidos_ahora;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                perdidos_ahora = perdidos;
+            }
+            if (escritos() + perdidos_ahora >= n) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+};
+
+ChangeEvent cambio(int id) {
+    return {std::chrono::system_clock::now(), ChangeEvent::SET, id, 0, 8, 1, 0};
+}
+
+}
+
+void test_block_generations() {
+    std::cout << "\nEjecutando prueba de generaciones de la tabla de bloques..." << std::endl;
+
+    BlockTable tabla;
+    uint32_t slot;
+    int viejo = tabla.insert(0, 8, 0, 0);
+    assert(tabla.find(viejo, slot) && slot == 0);
+    tabla.remove(slot);
+
+    // Un mismo slot liberado y reutilizado muchas más veces que las 2^9 de antes:
+    // la tabla sigue dando ids válidos sin crecer, y mientras la generación no
+    // da la vuelta ninguno se repite ni deja pasar el id viejo
+    std::unordered_set<int> vistos{viejo};
+    const uint32_t vueltas = 4 * BlockTable::kMaxGeneration;
+    for (uint32_t i = 0; i < vueltas; i++) {
+        int id = tabla.insert(0, 8, 0, 0);
+        assert(id > 0);
+        assert(tabla.find(id, slot) && slot == 0);
+        if (i + 1 < BlockTable::kMaxGeneration) {
+            assert(vistos.insert(id).second);
+            assert(!tabla.find(viejo, slot));
+            int cuenta;
+            assert(!tabla.addRef(viejo, cuenta));
+        }
+        tabla.remove(slot);
+    }
+    assert(tabla.count() == 0);
+
+    // Los slots libres se reutilizan del más antiguo al más reciente
+    int a = tabla.insert(0, 8, 0, 0);
+    int b = tabla.insert(8, 8, 0, 0);
+    int c = tabla.insert(16, 8, 0, 0);
+    uint32_t slot_a, slot_b;
+    assert(tabla.find(a, slot_a) && tabla.find(b, slot_b));
+    tabla.remove(slot_a);
+    tabla.remove(slot_b);
+    int d = tabla.insert(24, 8, 0, 0);
+    assert(tabla.find(d, slot) && slot == slot_a);
+    assert(tabla.find(c, slot));
+
+    std::cout << "Prueba de generaciones completada." << std::endl;
+}
+
+void test_dump_writer() {
+    std::cout << "\nEjecutando prueba del escritor de dumps..." << std::endl;
+
+    // Una ráfaga que llega dentro de la ventana sale en una sola escritura, en orden
+    {
+        Escrituras escrituras;
+        DumpWriter escritor(escrituras.funcion(), 64, std::chrono::milliseconds(100));
+        for (int i = 0; i < 10; i++) {
+            escritor.push(cambio(i));
+        }
+        assert(escrituras.esperar(10));
+        escritor.stop();
+        assert(escrituras.lotes.size() == 1);
+        assert(escrituras.perdidos == 0);
+        for (int i = 0; i < 10; i++) {
+            assert(escrituras.lotes[0][i].id == i);
+        }
+    }
+
+    // Con la cola llena los cambios se pierden, pero se cuentan y aun así se escribe
+    {
+        Escrituras escrituras;
+        DumpWriter escritor(escrituras.funcion(), 8, std::chrono::milliseconds(200));
+        for (int i = 0; i < 20; i++) {
+            escritor.push(cambio(i));
+        }
+        assert(escrituras.esperar(20));
+        escritor.stop();
+        assert(escrituras.escritos() + escrituras.perdidos == 20);
+        assert(escrituras.perdidos > 0);
+        assert(!escrituras.lotes.empty());
+    }
+
+    // stop() escribe lo que quede en la cola antes de terminar
+    {
+        Escrituras escrituras;
+        DumpWriter escritor(escrituras.funcion(), 64, std::chrono::milliseconds(50));
+        for (int i = 0; i < 3; i++) {
+            escritor.push(cambio(i));
+        }
+        escritor.stop();
+        assert(escrituras.escritos() == 3);
+    }
+
+    bool rechazada = false;
+    try {
+        DumpWriter escritor([](const std::vector<ChangeEvent>&, size_t) {}, 100);
+    } catch (const std::invalid_argument&) {
+        rechazada = true;
+    }
+    assert(rechazada);  // La capacidad tiene que ser potencia de dos
+
+    // Un archivo del journal tiene que caber un checkpoint entero (CHECKPOINT y
+    // un BLOCK por bloque) y al menos un cambio detrás
+    rechazada = false;
+    try {
+        Journal journal(carpetaDeDumps(), 1024, "tlsf", 1, 100, 101);
+    } catch (const std::invalid_argument&) {
+        rechazada = true;
+    }
+    assert(rechazada);
+    Journal journal(carpetaDeDumps(), 1024, "tlsf", 1, 100, 102);
+    assert(journal.atFileStart() && journal.room() == 102);
+
+    std::cout << "Prueba del escritor de dumps completada." << std::endl;
+}
+
+int main() {
+    try {
+        test_tlsf();
+        test_slabs();
+        test_buddy();
+        test_incremental_compaction();
+        test_concurrent_compaction();
+        test_shard_routing();
+        test_block_generations();
+        test_dump_writer();
+    } catch (const std::exception& e) {
+        std::cerr << "Excepción durante las pruebas: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "\nTodas las pruebas completadas exitosamente." << std::endl;
+    return 0;
+}
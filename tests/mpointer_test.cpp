@@ -11,6 +11,11 @@
 #include <vector>
 #include <cassert> // Para aserciones
 #include <stdexcept> // Para std::runtime_error
+#include <coroutine>
+#include <cstddef>
+#include <future>
+#include <thread>
+#include <cstdint>
 
 // --- Pruebas Básicas Existentes (Asumo que quieres mantenerlas) ---
 void test_basic_operations() {
@@ -114,6 +119,390 @@ void test_linked_list() {
     std::cout << "Prueba de LinkedList completada." << std::endl;
 }
 
+// --- Prueba de formatos de mensaje ---
+// El servidor responde en el formato de cada petición, así que ambos deben
+// poder mezclarse en la misma conexión
+void test_wire_formats() {
+    std::cout << "\nEjecutando prueba de formatos de mensaje V1/V2..." << std::endl;
+
+    MPointer<int> ptr = MPointer<int>::New();
+    *ptr = 7;
+
+    MPointerConnection::client_->setWireFormat(WireFormat::V1);
+    assert(*ptr == 7);
+    *ptr = 8;
+    MPointer<double> other = MPointer<double>::New();
+    *other = 2.5;
+    assert(*other == 2.5);
+
+    MPointerConnection::client_->setWireFormat(WireFormat::V2);
+    assert(*ptr == 8);
+    assert(*other == 2.5);
+
+    std::cout << "Prueba de formatos de mensaje completada." << std::endl;
+}
+
+// --- Prueba de la API asíncrona ---
+// Corrutina mínima para la prueba: empieza al llamarla y no se espera a sí misma
+struct TestCoroutine {
+    struct promise_type {
+        TestCoroutine get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Lanza todas las lecturas y luego las espera con co_await; tras reanudarse
+// también puede usar las operaciones bloqueantes
+TestCoroutine sumWithCoroutine(std::vector<MPointer<int>>& ptrs, std::promise<int>& result) {
+    try {
+        std::vector<AsyncResult<int>> reads;
+        for (const MPointer<int>& ptr : ptrs) {
+            reads.push_back(ptr.getAsync());
+        }
+        int sum = 0;
+        for (AsyncResult<int>& read : reads) {
+            sum += co_await read;
+        }
+        sum += *ptrs[0];
+        result.set_value(sum);
+    } catch (...) {
+        result.set_exception(std::current_exception());
+    }
+}
+
+void test_async_api() {
+    std::cout << "\nEjecutando prueba de la API asíncrona..." << std::endl;
+
+    std::vector<MPointer<int>> ptrs;
+    for (int i = 0; i < 8; i++) {
+        ptrs.push_back(MPointer<int>::New());
+    }
+
+    // Todas las escrituras en vuelo a la vez, esperadas como std::future
+    std::vector<AsyncResult<bool>> writes;
+    for (int i = 0; i < 8; i++) {
+        writes.push_back(ptrs[i].setAsync(i * 10));
+    }
+    for (AsyncResult<bool>& write : writes) {
+        assert(write.get());
+    }
+
+    std::vector<AsyncResult<int>> reads;
+    for (const MPointer<int>& ptr : ptrs) {
+        reads.push_back(ptr.getAsync());
+    }
+    for (int i = 0; i < 8; i++) {
+        assert(reads[i].get() == i * 10);
+    }
+
+    std::vector<char> data = MPointerConnection::client_->getMemoryBlockAsync(&ptrs[3]).get();
+    assert(data.size() >= sizeof(int));
+
+    std::promise<int> sum;
+    std::future<int> sumResult = sum.get_future();
+    sumWithCoroutine(ptrs, sum);
+    int total = sumResult.get();
+    assert(total == 280);   // 0 + 10 + ... + 70, más *ptrs[0] que vale 0
+    std::cout << "Suma leída desde una corrutina: " << total << std::endl;
+
+    std::cout << "Prueba de la API asíncrona completada." << std::endl;
+}
+
+// --- Prueba de BATCH ---
+// Las operaciones se refieren a bloques creados en el mismo lote
+void test_batch() {
+    std::cout << "\nEjecutando prueba de BATCH..." << std::endl;
+
+    struct Pair {
+        int value;
+        int other_id;
+    };
+    Pair pair{7, -1};
+    std::vector<char> data(sizeof(Pair));
+    std::memcpy(data.data(), &pair, sizeof(Pair));
+
+    SocketClient::Batch batch;
+    int first = batch.create(sizeof(Pair), MPointer<Pair>::typeId(), typeid(Pair).name());
+    int second = batch.create(sizeof(Pair), MPointer<Pair>::typeId(), typeid(Pair).name());
+    batch.set(first, data);
+    batch.link(first, offsetof(Pair, other_id), second);
+    batch.get(first);
+    batch.get(Message::batchRef(7));    // Referencia a una operación que no existe
+    std::vector<Message> responses = MPointerConnection::client_->execute(batch);
+    assert(responses.size() == 6);
+
+    int first_id = SocketClient::createdBlockId(responses[0]);
+    int second_id = SocketClient::createdBlockId(responses[1]);
+    std::vector<char> read = SocketClient::blockData(responses[4]);
+    std::memcpy(&pair, read.data(), sizeof(Pair));
+    assert(pair.value == 7);
+    assert(pair.other_id == second_id);
+    assert(!responses[5].isSuccess());
+    std::cout << "Bloque " << first_id << " enlazado con " << pair.other_id << " en un solo BATCH." << std::endl;
+
+    // Los bloques nacen con una referencia: soltarla
+    MPointerConnection::client_->decreaseRefCount(first_id);
+    MPointerConnection::client_->decreaseRefCount(second_id);
+
+    std::cout << "Prueba de BATCH completada." << std::endl;
+}
+
+// --- Prueba de CHASE ---
+// Acceso aleatorio a una lista larga: una ida y vuelta por consulta
+void test_chase() {
+    std::cout << "\nEjecutando prueba de CHASE..." << std::endl;
+
+    LinkedList<int> list;
+    for (int i = 0; i < 50; i++) {
+        list.pushBack(i * 2);
+    }
+    assert(list.get(0) == 0);
+    assert(list.get(25) == 50);
+    assert(list.get(49) == 98);
+
+    list.remove(49);    // La cola: tail_ pasa al anterior
+    list.pushBack(7);
+    assert(list.get(49) == 7);
+
+    // Un bloque cuyo "siguiente" es -1: la cadena se acaba en el primer salto
+    MPointer<int> end = MPointer<int>::New();
+    *end = -1;
+    assert(MPointerConnection::client_->chase(&end, 0, 0).id == &end);
+    bool failed = false;
+    try {
+        MPointerConnection::client_->chase(&end, 0, 1);
+    } catch (const std::exception&) {
+        failed = true;
+    }
+    assert(failed);
+
+    std::cout << "Prueba de CHASE completada." << std::endl;
+}
+
+struct Punto {
+    double x;
+    int etiqueta;
+    char nombre[12];
+};
+
+void test_ranges() {
+    std::cout << "\nEjecutando prueba de GET_RANGE/SET_RANGE..." << std::endl;
+
+    MPointer<Punto> p = MPointer<Punto>::New();
+    Punto inicial{1.5, 7, "origen"};
+    *p = inicial;
+
+    // Un campo se lee y escribe sin tocar los demás
+    assert(static_cast<int>(p.field(&Punto::etiqueta)) == 7);
+    p.field(&Punto::etiqueta) = 42;
+    p.field(&Punto::x) = 3.25;
+    Punto leido = *p;
+    assert(leido.x == 3.25);
+    assert(leido.etiqueta == 42);
+    assert(std::strcmp(leido.nombre, "origen") == 0);
+    assert(p.field(&Punto::x).getAsync().get() == 3.25);
+
+    // Rangos arbitrarios con el cliente
+    int id = &p;
+    size_t offset = offsetof(Punto, nombre);
+    assert(MPointerConnection::client_->setMemoryRange(id, offset, {'f', 'i', 'n', '\0'}));
+    std::vector<char> nombre = MPointerConnection::client_->getMemoryRange(id, offset, 4);
+    assert(nombre.size() == 4 && std::strcmp(nombre.data(), "fin") == 0);
+
+    // Fuera del bloque: el servidor lo rechaza
+    bool failed = !MPointerConnection::client_->setMemoryRange(id, sizeof(Punto) - 1, {'a', 'b'});
+    try {
+        MPointerConnection::client_->getMemoryRange(id, sizeof(Punto), 1);
+        failed = false;
+    } catch (const std::exception&) {
+    }
+    assert(failed);
+
+    std::cout << "Prueba de GET_RANGE/SET_RANGE completada." << std::endl;
+}
+
+void test_atomics() {
+    std::cout << "\nEjecutando prueba de operaciones atómicas..." << std::endl;
+
+    // Varios hilos incrementan el mismo contador sin perder ninguna suma
+    MPointer<int> contador = MPointer<int>::New();
+    *contador = 0;
+    std::vector<std::thread> hilos;
+    for (int t = 0; t < 4; t++) {
+        hilos.emplace_back([&contador]() {
+            for (int i = 0; i < 100; i++) {
+                contador.fetchAdd(1);
+            }
+        });
+    }
+    for (std::thread& hilo : hilos) {
+        hilo.join();
+    }
+    assert(*contador == 400);
+    assert(contador.fetchAdd(-400) == 400);
+    assert(*contador == 0);
+
+    // compareExchange sólo escribe si el valor es el esperado
+    int esperado = 5;
+    assert(!contador.compareExchange(esperado, 9));
+    assert(esperado == 0);
+    assert(contador.compareExchange(esperado, 9));
+    assert(contador.exchange(11) == 9);
+    assert(*contador == 11);
+
+    // Enteros de 8 bytes y campos de un struct
+    MPointer<int64_t> grande = MPointer<int64_t>::New();
+    *grande = int64_t(1) << 40;
+    assert(grande.fetchAdd(1) == int64_t(1) << 40);
+    assert(*grande == (int64_t(1) << 40) + 1);
+
+    MPointer<Punto> p = MPointer<Punto>::New();
+    *p = Punto{2.0, 1, "campo"};
+    assert(p.field(&Punto::etiqueta).fetchAdd(2) == 1);
+    Punto leido = *p;
+    assert(leido.etiqueta == 3 && leido.x == 2.0);
+
+    std::cout << "Prueba de operaciones atómicas completada." << std::endl;
+}
+
+// Por valor: la copia y su destrucción se anulan sin llegar al servidor
+int leerPorValor(MPointer<int> ptr) {
+    return *ptr;
+}
+
+// Espera a que el Garbage Collector libere el bloque (unos segundos como mucho)
+bool esperarLiberado(int id) {
+    for (int i = 0; i < 60; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        try {
+            MPointerConnection::client_->getMemoryBlock(id);
+        } catch (const std::exception&) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void test_refcount_coalescing() {
+    std::cout << "\nEjecutando prueba de contadores diferidos..." << std::endl;
+
+    MPointer<int> p = MPointer<int>::New();
+    *p = 5;
+    for (int i = 0; i < 200; i++) {
+        assert(leerPorValor(p) == 5);
+    }
+
+    // Las copias mantienen vivo el bloque aunque el original se suelte antes
+    int id = &p;
+    {
+        MPointer<int> a = p;
+        MPointer<int> b = a;
+        p = MPointer<int>();
+        MPointerConnection::client_->flushRefCountChanges();
+        assert(*b == 5);
+    }
+
+    // Sin referencias, el decremento sale como mucho un intervalo después y
+    // el Garbage Collector libera el bloque
+    assert(esperarLiberado(id));
+
+    std::cout << "Prueba de contadores diferidos completada." << std::endl;
+}
+
+void test_weighted_refs() {
+    std::cout << "\nEjecutando prueba de referencias con pesos..." << std::endl;
+
+    const uint32_t peso = MPointer<int>::kReferenceWeight;
+    MPointer<int> p = MPointer<int>::New();
+    *p = 3;
+    assert(p.weight() == peso);
+
+    // Una copia se lleva la mitad del peso, sin ir al servidor
+    MPointer<int> q = p;
+    assert(p.weight() + q.weight() == peso && q.weight() == peso / 2);
+
+    // Copiando hasta agotar el peso: la parte de peso 1 pide peso nuevo
+    std::vector<MPointer<int>> copias;
+    while (q.weight() > 1) {
+        copias.push_back(q);
+    }
+    MPointer<int> recargada = q;
+    assert(q.weight() == 1 && recargada.weight() == peso);
+    assert(*recargada == 3);
+
+    // Todas las partes vuelven al servidor al destruirse y el bloque se libera
+    int id = &p;
+    p = MPointer<int>();
+    q = MPointer<int>();
+    copias.clear();
+    assert(*recargada == 3);
+    recargada = MPointer<int>();
+    assert(esperarLiberado(id));
+
+    std::cout << "Prueba de referencias con pesos completada." << std::endl;
+}
+
+MPointer<int> crearEntero(int valor) {
+    MPointer<int> p = MPointer<int>::New();
+    *p = valor;
+    return p;
+}
+
+void test_move_semantics() {
+    std::cout << "\nEjecutando prueba de movimiento y referencias prestadas..." << std::endl;
+
+    const uint32_t peso = MPointer<int>::kReferenceWeight;
+
+    // Mover traspasa la referencia entera y deja el origen nulo
+    MPointer<int> a = crearEntero(9);
+    assert(a.weight() == peso);
+    MPointer<int> b = std::move(a);
+    assert(!a.isValid() && a.weight() == 0);
+    assert(b.weight() == peso && *b == 9);
+
+    // Un vector que crece mueve sus elementos, no los copia
+    std::vector<MPointer<int>> punteros;
+    for (int i = 0; i < 20; i++) {
+        punteros.push_back(crearEntero(i));
+    }
+    for (int i = 0; i < 20; i++) {
+        assert(punteros[i].weight() == peso && *punteros[i] == i);
+    }
+
+    // La asignación por movimiento devuelve el peso de lo que tenía
+    int id = &b;
+    b = std::move(punteros[0]);
+    assert(*b == 0 && !punteros[0].isValid());
+    assert(esperarLiberado(id));
+
+    // Una referencia prestada lee y escribe sin tocar el contador
+    MPointerRef<int> prestada = b;
+    assert(&prestada == &b && *prestada == 0);
+    *prestada = 5;
+    assert(*b == 5 && b.weight() == peso);
+
+    // LinkedList ya no necesita release(): pushFront, remove y print
+    LinkedList<int> list;
+    list.pushFront(2);
+    list.pushFront(1);
+    list.pushBack(3);
+    assert(list.get(0) == 1 && list.get(1) == 2 && list.get(2) == 3);
+    list.print();
+    list.remove(1);
+    assert(list.size() == 2 && list.get(1) == 3);
+    list.remove(0);
+    assert(list.size() == 1 && list.get(0) == 3);
+    list.pushFront(0);
+    list.remove(1);     // La cola
+    list.pushBack(4);
+    assert(list.get(0) == 0 && list.get(1) == 4);
+
+    std::cout << "Prueba de movimiento y referencias prestadas completada." << std::endl;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 3) {
         std::cerr << "Uso: " << argv[0] << " <host> <port>" << std::endl;
@@ -128,6 +517,15 @@ int main(int argc, char* argv[]) {
         MPointerConnection::Init(host, port); // Usar el Init centralizado
         test_basic_operations(); // Ejecutar prueba básica si se desea
         test_linked_list();    // Ejecutar prueba de lista enlazada
+        test_wire_formats();
+        test_async_api();
+        test_batch();
+        test_chase();
+        test_ranges();
+        test_atomics();
+        test_refcount_coalescing();
+        test_weighted_refs();
+        test_move_semantics();
     } catch (const std::exception& e) {
         std::cerr << "Error durante las pruebas: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,244 @@
+// journal_replay.cpp
+// Rebuilds the text dump of a memory manager that ran with --dumpMode journal,
+// as it was at any point in time, from the journal files in its dump folder.
+#include "../memory_manager/journal.h"
+#include "../memory_manager/block_table.h"
+#include "../memory_manager/type_registry.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " DUMP_FOLDER [--at \"YYYY-MM-DD HH:MM:SS[.mmm]\"]"
+              << " [--changes N] [--out FILE]" << std::endl;
+    std::cout << "  --at TIME     State at this local time (default: end of the journal)" << std::endl;
+    std::cout << "  --changes N   Also list the last N changes up to that time" << std::endl;
+    std::cout << "  --out FILE    Write the dump to FILE instead of standard output" << std::endl;
+}
+
+bool parseTime(const std::string& text, int64_t& timestamp_us) {
+    std::tm tm{};
+    std::istringstream in(text);
+    in >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+    if (in.fail()) {
+        return false;
+    }
+    int64_t ms = 0;
+    if (in.peek() == '.') {
+        in.get();
+        in >> ms;
+    }
+    tm.tm_isdst = -1;
+    std::time_t seconds = std::mktime(&tm);
+    if (seconds == -1) {
+        return false;
+    }
+    timestamp_us = (static_cast<int64_t>(seconds) * 1000 + ms) * 1000 + 999;
+    return true;
+}
+
+ChangeEvent toChange(const JournalRecord& record) {
+    static const ChangeEvent::Op ops[] = {ChangeEvent::CREATE, ChangeEvent::SET, ChangeEvent::ADD_REF,
+                                          ChangeEvent::DROP_REF, ChangeEvent::FREE, ChangeEvent::MOVE,
+                                          ChangeEvent::REMOVE};
+    return {std::chrono::system_clock::time_point(std::chrono::microseconds(record.timestamp_us)),
+            ops[record.op - JournalRecord::CREATE], record.id, record.offset, record.size,
+            record.ref_count, record.type_id};
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::string dumpFolder = argv[1];
+    int64_t until = INT64_MAX;
+    size_t changeCount = 0;
+    std::string outFile;
+
+    for (int i = 2; i < argc; i += 2) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--at") {
+            if (!parseTime(argv[i + 1], until)) {
+                std::cerr << "Invalid time: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--changes") {
+            changeCount = std::stoul(argv[i + 1]);
+        } else if (arg == "--out") {
+            outFile = argv[i + 1];
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    TypeRegistry types;
+    std::ifstream typesFile(Journal::typesFileName(dumpFolder));
+    std::string line;
+    while (std::getline(typesFile, line)) {
+        size_t space = line.find(' ');
+        if (space != std::string::npos) {
+            types.add(static_cast<uint32_t>(std::stoul(line.substr(0, space), nullptr, 16)), line.substr(space + 1));
+        }
+    }
+
+    std::vector<std::string> files = Journal::listFiles(dumpFolder);
+    if (files.empty()) {
+        std::cerr << "No journal files in " << dumpFolder << std::endl;
+        return 1;
+    }
+
+    // Replay the records in order. Every record holds absolute values, so
+    // applying one is just overwriting the block's fields.
+    JournalHeader header{};
+    std::map<int, DumpSnapshot::Block> blocks;
+    std::vector<ChangeEvent> changes;
+    int64_t last_timestamp = 0;
+    bool done = false;
+    for (const std::string& name : files) {
+        std::ifstream file(name, std::ios::binary);
+        JournalHeader file_header{};
+        if (!file.read(reinterpret_cast<char*>(&file_header), sizeof(file_header)) ||
+            memcmp(file_header.magic, Journal::kMagic, sizeof(Journal::kMagic)) != 0 ||
+            file_header.record_size != sizeof(JournalRecord)) {
+            std::cerr << "Skipping " << name << ": not a journal file" << std::endl;
+            continue;
+        }
+
+        JournalRecord record;
+        while (!done && file.read(reinterpret_cast<char*>(&record), sizeof(record)) &&
+               record.op != JournalRecord::END) {
+            if (record.timestamp_us > until) {
+                done = true;
+                break;
+            }
+            header = file_header;
+            last_timestamp = std::max(last_timestamp, record.timestamp_us);
+
+            switch (record.op) {
+                case JournalRecord::CHECKPOINT:
+                    blocks.clear();
+                    break;
+                case JournalRecord::BLOCK:
+                    blocks[record.id] = {record.id, record.offset, record.size, record.type_id,
+                                         record.ref_count, (record.flags & JournalRecord::kInUse) != 0};
+                    break;
+                case JournalRecord::CREATE:
+                    blocks[record.id] = {record.id, record.offset, record.size, record.type_id,
+                                         record.ref_count, true};
+                    break;
+                case JournalRecord::SET:
+                case JournalRecord::MOVE:
+                case JournalRecord::FREE:
+                case JournalRecord::ADD_REF:
+                case JournalRecord::DROP_REF: {
+                    // Unknown ids belong to files rotation already deleted
+                    auto block = blocks.find(record.id);
+                    if (block == blocks.end()) {
+                        break;
+                    }
+                    block->second.ref_count = record.ref_count;
+                    if (record.op == JournalRecord::FREE) {
+                        block->second.in_use = false;
+                    } else if (record.op == JournalRecord::SET || record.op == JournalRecord::MOVE) {
+                        block->second.offset = record.offset;
+                    }
+                    break;
+                }
+                case JournalRecord::REMOVE:
+                    blocks.erase(record.id);
+                    break;
+            }
+
+            if (record.op >= JournalRecord::CREATE && record.op <= JournalRecord::REMOVE && changeCount != 0) {
+                changes.push_back(toChange(record));
+                if (changes.size() > changeCount) {
+                    changes.erase(changes.begin());
+                }
+            }
+        }
+        if (done) {
+            break;
+        }
+    }
+
+    if (header.record_size == 0) {
+        std::cerr << "Nothing was recorded up to that time" << std::endl;
+        return 1;
+    }
+
+    // Rebuild the snapshot the memory manager would have taken. Shards are laid
+    // out like MemoryManager does; free space is derived from the live blocks,
+    // since the journal doesn't record the allocator's own bookkeeping.
+    DumpSnapshot snapshot;
+    snapshot.timestamp = std::chrono::system_clock::time_point(std::chrono::microseconds(last_timestamp));
+    snapshot.memory_size = header.memory_size;
+    snapshot.allocator = std::string(header.allocator, strnlen(header.allocator, sizeof(header.allocator)));
+
+    size_t shard_count = std::max<uint32_t>(header.shard_count, 1);
+    size_t shard_size = snapshot.memory_size / shard_count & ~size_t(15);
+    for (size_t i = 0; i < shard_count; i++) {
+        size_t base = i * shard_size;
+        size_t size = i + 1 == shard_count ? snapshot.memory_size - base : shard_size;
+        snapshot.shards.push_back({base, size, size, 0});
+    }
+
+    for (auto& entry : blocks) {
+        snapshot.blocks.push_back(entry.second);
+    }
+    // Slot order, like BlockTable::forEach
+    std::sort(snapshot.blocks.begin(), snapshot.blocks.end(), [](const auto& a, const auto& b) {
+        return (static_cast<uint32_t>(a.id) & (BlockTable::kMaxSlots - 1)) <
+               (static_cast<uint32_t>(b.id) & (BlockTable::kMaxSlots - 1));
+    });
+
+    std::vector<std::vector<const DumpSnapshot::Block*>> used(shard_count);
+    for (const DumpSnapshot::Block& block : snapshot.blocks) {
+        size_t shard = std::min(shard_size ? block.offset / shard_size : 0, shard_count - 1);
+        snapshot.shards[shard].block_count++;
+        if (block.in_use) {
+            snapshot.shards[shard].free_bytes -= std::min(block.size, snapshot.shards[shard].free_bytes);
+            used[shard].push_back(&block);
+        }
+    }
+    for (size_t i = 0; i < shard_count; i++) {
+        std::sort(used[i].begin(), used[i].end(), [](auto a, auto b) { return a->offset < b->offset; });
+        size_t cursor = snapshot.shards[i].offset;
+        for (const DumpSnapshot::Block* block : used[i]) {
+            if (block->offset > cursor) {
+                snapshot.free_extents++;
+            }
+            cursor = std::max(cursor, block->offset + block->size);
+        }
+        if (cursor < snapshot.shards[i].offset + snapshot.shards[i].size) {
+            snapshot.free_extents++;
+        }
+    }
+
+    if (outFile.empty()) {
+        writeDumpText(std::cout, snapshot, changes, 0, types);
+        std::cout << std::endl;
+    } else {
+        std::ofstream out(outFile);
+        if (!out) {
+            std::cerr << "Failed to create " << outFile << std::endl;
+            return 1;
+        }
+        writeDumpText(out, snapshot, changes, 0, types);
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+// net_benchmark.cpp
+// Serves the same memory manager through each network backend in turn and
+// drives it with many clients, to compare throughput and how many system calls
+// each backend spends per request.
+#include "../memory_manager/memory_manager.h"
+#include "../memory_manager/network_server.h"
+#include "../protocol/message.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [--connections C] [--requests R] [--depth D]"
+              << " [--workers N] [--backends epoll,io_uring,threads] [--format v1|v2] [--port PORT]" << std::endl;
+    std::cout << "  --connections C  Concurrent clients (default 64)" << std::endl;
+    std::cout << "  --requests R     GET requests per client (default 2000)" << std::endl;
+    std::cout << "  --depth D        Requests each client sends before reading the answers (default 1)" << std::endl;
+    std::cout << "  --workers N      Worker threads for epoll and io_uring (default: one per core)" << std::endl;
+    std::cout << "  --backends LIST  Backends to measure, in order (default epoll,io_uring)" << std::endl;
+    std::cout << "  --format F       Wire format of the requests (default v2)" << std::endl;
+    std::cout << "  --port PORT      First port to listen on; each backend uses the next one (default 19090)" << std::endl;
+}
+
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool receiveAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+// One client: R requests for the same block, D at a time. Returns the answers that succeeded.
+size_t runClient(int port, int block_id, size_t requests, size_t depth, WireFormat format) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::cerr << "Failed to connect to port " << port << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    std::vector<char> request = Message::getRequest(block_id).serialize(format);
+    int length = static_cast<int>(request.size());
+    std::vector<char> frame(reinterpret_cast<const char*>(&length), reinterpret_cast<const char*>(&length) + sizeof(int));
+    frame.insert(frame.end(), request.begin(), request.end());
+
+    size_t ok = 0;
+    std::vector<char> batch;
+    std::vector<char> response;
+    for (size_t done = 0; done < requests;) {
+        size_t count = std::min(depth, requests - done);
+        batch.clear();
+        for (size_t i = 0; i < count; i++) {
+            batch.insert(batch.end(), frame.begin(), frame.end());
+        }
+        if (!sendAll(fd, batch.data(), batch.size())) {
+            break;
+        }
+        for (size_t i = 0; i < count; i++) {
+            int response_length;
+            if (!receiveAll(fd, reinterpret_cast<char*>(&response_length), sizeof(int))) {
+                close(fd);
+                return ok;
+            }
+            response.resize(response_length);
+            if (!receiveAll(fd, response.data(), response.size())) {
+                close(fd);
+                return ok;
+            }
+            ok += Message::deserialize(response).isSuccess();
+        }
+        done += count;
+    }
+    close(fd);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    size_t connections = 64;
+    size_t requests = 2000;
+    size_t depth = 1;
+    size_t workers = 0;
+    int port = 19090;
+    WireFormat format = WireFormat::V2;
+    std::string backendList = "epoll,io_uring";
+
+    for (int i = 1; i < argc; i += 2) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--connections") {
+            connections = std::stoul(argv[i + 1]);
+        } else if (arg == "--requests") {
+            requests = std::stoul(argv[i + 1]);
+        } else if (arg == "--depth") {
+            depth = std::max<size_t>(1, std::stoul(argv[i + 1]));
+        } else if (arg == "--workers") {
+            workers = std::stoul(argv[i + 1]);
+        } else if (arg == "--backends") {
+            backendList = argv[i + 1];
+        } else if (arg == "--format") {
+            std::string value = argv[i + 1];
+            if (value != "v1" && value != "v2") {
+                std::cerr << "Unknown format: " << value << std::endl;
+                return 1;
+            }
+            format = value == "v1" ? WireFormat::V1 : WireFormat::V2;
+        } else if (arg == "--port") {
+            port = std::stoi(argv[i + 1]);
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::pair<std::string, NetworkBackend>> backends;
+    std::stringstream names(backendList);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        NetworkBackend backend;
+        if (!parseNetworkBackend(name, backend)) {
+            std::cerr << "Unknown or unavailable backend: " << name << std::endl;
+            return 1;
+        }
+        backends.emplace_back(name, backend);
+    }
+
+    // Journal mode keeps the dump folder small; GETs don't record anything anyway
+    std::filesystem::path dumpFolder = std::filesystem::temp_directory_path() / "net_benchmark_dumps";
+    std::filesystem::create_directories(dumpFolder);
+    MemoryManager memoryManager(16, dumpFolder.string(), AllocationPolicy::FREE_LIST, kDefaultSlabThreshold, 1,
+                                DumpMode::JOURNAL);
+    int blockId = memoryManager.create(64, 0);
+
+    struct Result {
+        std::string backend;
+        size_t ok;
+        NetworkStats stats;
+        double seconds;
+    };
+    std::vector<Result> results;
+
+    for (const auto& backend : backends) {
+        std::unique_ptr<NetworkServer> server = makeNetworkServer(backend.second, port++, &memoryManager, workers);
+        server->start();
+
+        std::atomic<size_t> ok{0};
+        std::vector<std::thread> clients;
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < connections; i++) {
+            clients.emplace_back([&, serverPort = port - 1]() {
+                ok += runClient(serverPort, blockId, requests, depth, format);
+            });
+        }
+        for (std::thread& client : clients) {
+            client.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        results.push_back({backend.first, ok.load(), server->stats(), seconds});
+        server->stop();
+    }
+
+    std::cout << "\n" << connections << " connection(s) x " << requests << " request(s), depth " << depth << "\n\n";
+    std::cout << std::left << std::setw(10) << "backend" << std::right << std::setw(12) << "requests"
+              << std::setw(12) << "failed" << std::setw(12) << "syscalls" << std::setw(14) << "syscalls/req"
+              << std::setw(12) << "req/s" << std::endl;
+    for (const Result& result : results) {
+        double perRequest = result.stats.requests ? double(result.stats.syscalls) / result.stats.requests : 0;
+        std::cout << std::left << std::setw(10) << result.backend << std::right
+                  << std::setw(12) << result.stats.requests
+                  << std::setw(12) << connections * requests - result.ok
+                  << std::setw(12) << result.stats.syscalls
+                  << std::setw(14) << std::fixed << std::setprecision(3) << perRequest
+                  << std::setw(12) << std::setprecision(0) << result.ok / result.seconds << std::endl;
+    }
+    return 0;
+}